@@ -0,0 +1,57 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <mutex>
+
+namespace vkl
+{
+	//the table never grows past this, Device::maxBindlessTextures is what it gets on a given device
+	constexpr uint32_t MaxBindlessTextures = 4096;
+	//per stage sampler slots left to the set 0 textures of pipelines using the table
+	constexpr uint32_t BindlessReservedTextures = 16;
+	constexpr uint32_t NoBindlessIndex = ~0u;
+	//set index pipelines that use bindless textures get the table at
+	constexpr uint32_t BindlessTextureSet = 1;
+
+	//one global, partially bound, update after bind array of combined image samplers, shaders pick entries by index
+	//layout(set = 1, binding = 0) uniform sampler2D textures[];
+	class VKL_EXPORT BindlessTextureTable
+	{
+	public:
+		BindlessTextureTable() = delete;
+		explicit BindlessTextureTable(const Device& device);
+		~BindlessTextureTable() = default;
+		BindlessTextureTable(const BindlessTextureTable&) = delete;
+		BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+		//layouts made by this are compatible with the table's, pipelines create their own copy
+		static VkDescriptorSetLayout createSetLayout(const Device& device);
+
+		//stable until remove, NoBindlessIndex once Device::maxBindlessTextures are in use
+		uint32_t add(const Device& device, VkImageView view, VkSampler sampler);
+		//the index is handed out again once every frame in flight at the time of the call is done
+		void remove(uint32_t index);
+		//once per frame after the frame's fence was waited on
+		void collect(size_t framesInFlight);
+
+		VkDescriptorSet setHandle() const;
+		VkDescriptorSetLayout layoutHandle() const;
+		uint32_t textureCount() const;
+		uint32_t capacity() const;
+
+		void cleanUp(const Device& device);
+	private:
+		VkDescriptorPool _pool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _layout{ VK_NULL_HANDLE };
+		VkDescriptorSet _set{ VK_NULL_HANDLE };
+
+		uint32_t _capacity{ 0 };
+
+		mutable std::mutex _mutex;
+		uint32_t _nextIndex{ 0 };
+		uint32_t _textureCount{ 0 };
+		std::vector<uint32_t> _freeIndices;
+		std::vector<std::pair<uint64_t, uint32_t>> _pendingIndices;
+		uint64_t _frameSerial{ 0 };
+	};
+}
@@ -3,6 +3,8 @@
 #include <memory>
 #include <vkl/TextureBuffer.h>
 #include <vkl/UniformBuffer.h>
+#include <vkl/BindlessTextures.h>
+#include <vkl/DirtyList.h>
 
 namespace vkl
 {
@@ -12,22 +14,32 @@ namespace vkl
 		BufferManager(const Device& device, const SwapChain& swapChain);
 		~BufferManager();
 
+		//only touches the buffers queued since they were last clean, see DirtyList
 		void update(const Device& device, const SwapChain& swapChain);
+		//buffers the next update will touch
+		size_t pendingUpdates() const;
 
-		std::shared_ptr<IndexBuffer> createIndexBuffer(const Device& device, const SwapChain& swapChain);
-		std::shared_ptr<VertexBuffer> createVertexBuffer(const Device& device, const SwapChain& swapChain);
+		//Static for geometry that is set once, it then lives in DEVICE_LOCAL memory once instead of host visible memory per frame
+		std::shared_ptr<IndexBuffer> createIndexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage = BufferUsage::Dynamic);
+		std::shared_ptr<VertexBuffer> createVertexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage = BufferUsage::Dynamic);
 		std::shared_ptr<TextureBuffer> createTextureBuffer(const Device& device, const SwapChain& swapChain, const void* imageData, size_t width, size_t height, size_t components, const TextureOptions& options = {});
 
 		template <typename T>
 		std::shared_ptr<TypedUniform<T>> createTypedUniform(const Device& device, const SwapChain& swapChain)
 		{
-			auto newOne = std::make_shared<TypedUniform<T>>(device, swapChain);
+			auto newOne = std::make_shared<TypedUniform<T>>(device, swapChain, _uniformRing);
+			_dirtyList.attach(*newOne);
 			_uniformBuffers.emplace_back(newOne);
 			return newOne;
 		}
 
 		std::shared_ptr<UniformBuffer> createUniformBuffer(const Device& device, const SwapChain& swapChain);
 
+		//every texture, existing and future, gets a slot in one global table (needs Device::bindlessSupported)
+		void enableBindlessTextures(const Device& device);
+		std::shared_ptr<const BindlessTextureTable> bindlessTextures() const;
+
+		//drops buffers nothing else holds, their vulkan objects wait in Device::deletionQueue for the frames still using them
 		void cleanUnusedBuffers(const Device& device);
 
 		void cleanUp(const Device& device);
@@ -38,5 +50,11 @@ namespace vkl
 		std::vector<std::shared_ptr<VertexBuffer>> _vertexBuffers;
 		std::vector<std::shared_ptr<TextureBuffer>> _textureBuffers;
 		std::vector<std::shared_ptr<UniformBuffer>> _uniformBuffers;
+		//every uniform's per frame copies are slots in here
+		std::shared_ptr<UniformRing> _uniformRing;
+		//every index, vertex and uniform buffer is attached, the ones with work left for some frame are queued
+		DirtyList _dirtyList;
+
+		std::shared_ptr<BindlessTextureTable> _bindlessTextures;
 	};
 }
\ No newline at end of file
@@ -1,13 +1,37 @@
 #pragma once
 
 #include <vkl/Common.h>
+#include <vkl/DrawPacket.h>
+#include <vkl/FrustumCulling.h>
+#include <array>
 #include <memory>
+#include <unordered_map>
 
 namespace vkl
 {
-	class CommandThread;
+	class CommandRecorder;
 	class PipelineManager;
 
+	//what one thread did during the last dispatch
+	struct DispatchThreadStats
+	{
+		uint64_t recordNanos{ 0 };
+		uint32_t objects{ 0 };
+		uint32_t chunks{ 0 };
+		//state changes recorded vs dropped because the command buffer already had them
+		uint32_t bindsIssued{ 0 };
+		uint32_t bindsSkipped{ 0 };
+	};
+
+	//bounding spheres the last dispatch tested against the frustum vs the ones that passed
+	struct CullStats
+	{
+		uint32_t tested{ 0 };
+		uint32_t visible{ 0 };
+		//of the visible ones, held back to the predicated second phase because the occlusion results had them hidden
+		uint32_t occluded{ 0 };
+	};
+
 	class VKL_EXPORT CommandDispatcher
 	{
 	public:
@@ -21,13 +45,131 @@ namespace vkl
 		CommandDispatcher& operator=(const CommandDispatcher&) = delete;
 
 		void processUnsortedObjects(std::span< std::shared_ptr<RenderObject>> objects, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent);
+		//same as above but objects are radix sorted by RenderObject::sortKey first so neighbours share state
+		void processSortedObjects(std::span< std::shared_ptr<RenderObject>> objects, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent);
 
 		VkCommandBuffer primaryCommandBuffer(size_t frame) const;
 
+		//updated and recorded ahead of the render pass every frame, in the order they were added
+		void addCuller(std::shared_ptr<GpuCuller> culler);
+		void removeCuller(const GpuCuller* culler);
+
+		//objects with a RenderObject::boundingSphere outside the frustum are skipped before descriptor updates and recording
+		void setCullFrustum(const CullFrustum& frustum);
+		void disableCulling();
+		CullStats cullStats() const;
+
+		//two phase occlusion culling, only with a RenderPassOptions::occlusionCulling pass, null turns it off
+		//objects the culler last found hidden are drawn after the hi-z build in RenderPass::resumeHandle, each predicated on this frame's test
+		void setOcclusionCuller(std::shared_ptr<OcclusionCuller> culler);
+
+		//indexed by JobSystem::threadIndex()
+		std::span<const DispatchThreadStats> threadStats() const;
+
 		void cleanUp(const Device& device);
 	private:
-		VkCommandPool _commandPool{ VK_NULL_HANDLE };
-		std::vector<std::unique_ptr<CommandThread>> _threads;
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		//contiguous run of the dynamic list recorded into its own secondary
+		struct RecordChunk
+		{
+			size_t begin;
+			size_t end;
+		};
+
+		//one packet of the second phase, test is the object's index in the culler's spheres
+		struct LateDraw
+		{
+			RenderObject* object;
+			uint32_t test;
+		};
+
+		struct OcclusionState
+		{
+			bool occluded{ false };
+			uint64_t lastTested{ 0 };
+		};
+
+		//persistent per frame-in-flight secondaries for a static object
+		struct CachedCommands
+		{
+			uint64_t objectId{ 0 };
+			size_t owner{ 0 };
+			uint64_t lastUsed{ 0 };
+			std::vector<VkCommandBuffer> buffers;
+			std::vector<uint64_t> signatures;
+		};
+
+		void recordDrawList(const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent);
+		//cuts a list into contiguous runs of roughly equal record cost, a run also starts at every index in breaks (ascending)
+		void buildChunks(std::span<RenderObject* const> list, std::vector<RecordChunk>& chunks, std::span<const size_t> breaks = {});
+		//fills _visibleList with the objects that pass the frustum, in their original order
+		void cullObjects(std::span<std::shared_ptr<RenderObject>> objects);
+		//moves the objects the occlusion results had hidden from _visibleList to _occludedList, every tested sphere goes to the culler
+		void splitOccluded(const SwapChain& swapChain, const RenderPass& pass);
+		//second phase and whatever has to be drawn over it, inline in the primary
+		void recordLate(VkCommandBuffer buffer, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent);
+
+		//one per frame in flight, bulk reset instead of resetting buffers one by one
+		std::vector<VkCommandPool> _commandPools;
+		std::vector<std::unique_ptr<CommandRecorder>> _recorders;
+		std::vector<VkCommandBuffer> _secondaryBuffers;
 		std::vector<VkCommandBuffer> _primaryBuffers;
+
+		//reused every frame
+		std::vector<RenderObject*> _drawList;
+		std::vector<RenderObject*> _visibleList;
+		std::vector<float> _cullX;
+		std::vector<float> _cullY;
+		std::vector<float> _cullZ;
+		std::vector<float> _cullRadius;
+		std::vector<uint8_t> _cullVisible;
+		std::vector<SortItem> _sortItems;
+		std::vector<SortItem> _sortScratch;
+		std::vector<RenderObject*> _dynamicList;
+		//one per dynamic object, a null pipeline means record through RenderObject::recordCommands
+		std::vector<DrawPacket> _packets;
+		std::vector<PacketDraw> _packetDraws;
+		std::vector<RecordChunk> _chunks;
+		//RenderPassOptions::depthPrePass, recorded ahead of everything else
+		std::vector<RenderObject*> _depthList;
+		std::vector<DrawPacket> _depthPackets;
+		std::vector<PacketDraw> _depthDraws;
+		std::vector<RecordChunk> _depthChunks;
+		std::vector<VkCommandBuffer> _depthBuffers;
+		std::vector<VkCommandBuffer> _staticBuffers;
+		//_dynamicList indices with a static object sorted right before them
+		std::vector<size_t> _dynamicBreaks;
+		//_staticBuffers and _secondaryBuffers merged in _drawList order
+		std::vector<VkCommandBuffer> _mainBuffers;
+		std::vector<std::vector<std::pair<RenderObject*, CachedCommands*>>> _staticRecords;
+		std::vector<size_t> _staticOwners;
+		std::vector<DispatchThreadStats> _threadStats;
+
+		std::vector<std::shared_ptr<GpuCuller>> _cullers;
+
+		std::shared_ptr<OcclusionCuller> _occlusionCuller;
+		bool _occlusionActive{ false };
+		std::vector<RenderObject*> _occludedList;
+		std::vector<uint32_t> _occludedTests;
+		std::vector<std::array<float, 4>> _occlusionSpheres;
+		//objectIds in the order they were tested, per frame in flight until its results are read back
+		std::vector<std::vector<uint64_t>> _occlusionIds;
+		std::unordered_map<uint64_t, OcclusionState> _occlusionStates;
+		std::vector<LateDraw> _lateDraws;
+		std::vector<DrawPacket> _latePackets;
+		std::vector<PacketDraw> _latePacketDraws;
+
+		CullFrustum _frustum{};
+		bool _frustumCulling{ false };
+		CullStats _cullStats;
+
+		std::unordered_map<const RenderObject*, CachedCommands> _staticCache;
+		size_t _nextStaticOwner{ 0 };
+		uint64_t _frameSerial{ 0 };
 	};
-}
\ No newline at end of file
+}
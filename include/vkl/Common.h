@@ -34,6 +34,10 @@ namespace vkl
     class CommandDispatcher;
     class BufferManager;
     class PushConstantBase;
+    class BindlessTextureTable;
+    class GpuCuller;
+    class OcclusionCuller;
+    class UniformRing;
 
     struct WindowSize
     {
@@ -41,6 +45,43 @@ namespace vkl
         uint32_t height = 0;
     };
 
+    //how often a vertex/index buffer's contents change, picked when BufferManager creates it
+    enum class BufferUsage : uint8_t
+    {
+        //written once or rarely, one DEVICE_LOCAL buffer shared by every frame and filled through a staging copy
+        Static,
+        //a host visible copy per frame in flight, written directly
+        Dynamic,
+        //rewritten most frames, stored like Dynamic
+        Streaming
+    };
+
+    //byte intervals of a buffer waiting to be copied, kept sorted with overlapping and touching ones merged
+    class VKL_EXPORT DirtyRanges
+    {
+    public:
+        //past this many the intervals collapse into one covering them all
+        static constexpr size_t MaxRanges = 16;
+
+        struct Range
+        {
+            size_t offset{ 0 };
+            size_t size{ 0 };
+        };
+
+        void add(size_t offset, size_t size);
+        void addAll();
+        void clear();
+        bool empty() const;
+        std::span<const Range> ranges() const;
+
+        //copies every interval clipped to size from src to dst at the same offset, clears and returns the bytes copied
+        size_t copy(void* dst, const void* src, size_t size);
+
+    private:
+        std::vector<Range> _ranges;
+    };
+
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
@@ -74,5 +115,9 @@ namespace vkl
 
     VKL_EXPORT void copyBufferToImage(const Device& device, const SwapChain& swapChain, size_t frame, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
+    //DEVICE_LOCAL buffer filled from a staging copy recorded into the frame's one off commands, keep the staging buffer until the frame comes around again
+    VKL_EXPORT void createDeviceLocalBuffer(const Device& device, const SwapChain& swapChain, size_t frame, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess,
+        VkBuffer& buffer, VmaAllocation& memory, VkBuffer& stagingBuffer, VmaAllocation& stagingMemory);
+
     VKL_EXPORT void generateMipmaps(const Device& device, const SwapChain& swapChain, size_t frame, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 }
\ No newline at end of file
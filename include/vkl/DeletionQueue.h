@@ -0,0 +1,69 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace vkl
+{
+	//vulkan objects a frame in flight may still use, destroyed once every frame in flight at the time of the call has finished on the gpu
+	class VKL_EXPORT DeletionQueue
+	{
+	public:
+		//what collect may spend destroying per frame unless told otherwise, the rest waits for the next one
+		static constexpr std::chrono::microseconds DefaultBudget{ 500 };
+
+		DeletionQueue() = default;
+		~DeletionQueue() = default;
+		DeletionQueue(const DeletionQueue&) = delete;
+		DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+		void destroyBuffer(VkBuffer buffer, VmaAllocation memory);
+		void destroyImage(VkImage image, VmaAllocation memory);
+		void destroyImageView(VkImageView view);
+		void destroySampler(VkSampler sampler);
+		void destroyDescriptorPool(VkDescriptorPool pool);
+
+		//once per frame after the frame's fence was waited on (SwapChain::prepNextFrame), at least one retired object goes per call
+		void collect(const Device& device, size_t framesInFlight, std::chrono::nanoseconds budget = DefaultBudget);
+
+		//queued, retired by the gpu or not
+		size_t pending() const;
+
+		//everything regardless of frames, only once the device is idle
+		void cleanUp(const Device& device);
+	private:
+		enum class Type : uint8_t
+		{
+			Buffer,
+			Image,
+			ImageView,
+			Sampler,
+			DescriptorPool
+		};
+
+		struct Entry
+		{
+			uint64_t serial{ 0 };
+			Type type{ Type::Buffer };
+			VmaAllocation memory{ nullptr };
+			union
+			{
+				VkBuffer buffer{ VK_NULL_HANDLE };
+				VkImage image;
+				VkImageView view;
+				VkSampler sampler;
+				VkDescriptorPool pool;
+			};
+		};
+
+		void push(Entry& entry);
+		void destroy(const Device& device, const Entry& entry);
+
+		mutable std::mutex _mutex;
+		//in serial order
+		std::deque<Entry> _entries;
+		uint64_t _frameSerial{ 0 };
+	};
+}
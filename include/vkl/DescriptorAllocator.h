@@ -0,0 +1,72 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace vkl
+{
+	struct DescriptorPoolStats
+	{
+		uint32_t layouts{ 0 };
+		uint32_t pools{ 0 };
+		//sets the pools were sized for
+		uint32_t setCapacity{ 0 };
+		uint32_t setsInUse{ 0 };
+		//recycled and ready to hand out again
+		uint32_t setsFree{ 0 };
+		//freed but possibly still referenced by a frame in flight
+		uint32_t setsPending{ 0 };
+	};
+
+	//device wide pages of descriptor pools, one chain per set layout, sets are recycled instead of freed back to the pool
+	class VKL_EXPORT DescriptorAllocator
+	{
+	public:
+		DescriptorAllocator() = default;
+		~DescriptorAllocator() = default;
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		//perSetSizes is what one set of this layout needs, it has to be the same every call for a given layout
+		void allocate(const Device& device, VkDescriptorSetLayout layout, std::span<const VkDescriptorPoolSize> perSetSizes, std::span<VkDescriptorSet> sets);
+
+		//the sets come back once every frame in flight at the time of the call has finished on the gpu
+		void free(VkDescriptorSetLayout layout, std::span<const VkDescriptorSet> sets);
+
+		//once per frame after the frame's fence was waited on (SwapChain::prepNextFrame)
+		void collect(size_t framesInFlight);
+
+		//before the layout itself is destroyed, every set of it goes with its pools once the frames in flight are done with them
+		void releaseLayout(const Device& device, VkDescriptorSetLayout layout);
+
+		DescriptorPoolStats stats() const;
+
+		void cleanUp(const Device& device);
+	private:
+		struct PendingFree
+		{
+			uint64_t serial;
+			VkDescriptorSet set;
+		};
+
+		struct LayoutPools
+		{
+			std::vector<VkDescriptorPoolSize> perSetSizes;
+			std::vector<VkDescriptorPool> pools;
+			//sets left in the last pool before it has to grow
+			uint32_t remaining{ 0 };
+			uint32_t nextPoolSize{ 0 };
+			uint32_t capacity{ 0 };
+			uint32_t inUse{ 0 };
+			std::vector<VkDescriptorSet> freeSets;
+			std::vector<PendingFree> pending;
+		};
+
+		void addPool(const Device& device, LayoutPools& pools);
+
+		mutable std::mutex _mutex;
+		std::unordered_map<VkDescriptorSetLayout, LayoutPools> _layouts;
+		uint64_t _frameSerial{ 0 };
+	};
+}
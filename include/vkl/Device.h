@@ -1,15 +1,19 @@
 #pragma once
 #include <vkl/Common.h>
 
+#include <memory>
 
 namespace vkl
 {
+	class DescriptorAllocator;
+	class DeletionQueue;
+
 	class VKL_EXPORT Device
 	{
 	public:
 		Device() = delete;
 		Device(const Instance& instance, const Surface& surface);
-		~Device() = default;
+		~Device();
 
 		VkDevice handle() const;
 		VkPhysicalDevice physicalDeviceHandle() const;
@@ -20,6 +24,36 @@ namespace vkl
 		//We use VMA for vulkan memory - don't allocate your own buffers/images
 		VmaAllocator allocatorHandle() const;
 
+		//VK_KHR_push_descriptor, enabled when the device has it
+		bool pushDescriptorsSupported() const;
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate() const;
+		uint32_t maxPushDescriptors() const;
+
+		//VK_EXT_descriptor_indexing with what BindlessTextureTable needs
+		bool bindlessSupported() const;
+		//MaxBindlessTextures clamped to the device's update after bind sampler and sampled image limits, 0 without bindless
+		uint32_t maxBindlessTextures() const;
+
+		//indirect draws with a first instance, what GpuCuller's output needs
+		bool drawIndirectFirstInstanceSupported() const;
+		//more than one command per vkCmdDrawIndexedIndirect
+		bool multiDrawIndirectSupported() const;
+		//VK_KHR_draw_indirect_count, null when the device doesn't have it
+		PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const;
+		//VK_EXT_conditional_rendering, null when the device doesn't have it
+		PFN_vkCmdBeginConditionalRenderingEXT cmdBeginConditionalRendering() const;
+		PFN_vkCmdEndConditionalRenderingEXT cmdEndConditionalRendering() const;
+
+		//uniform slots UniformRing hands out start on multiples of this
+		VkDeviceSize minUniformBufferOffsetAlignment() const;
+		//UNIFORM_BUFFER_DYNAMIC bindings one pipeline layout may have
+		uint32_t maxDynamicUniformBuffers() const;
+
+		//shared by every RenderObject, sets are allocated from pools per layout instead of a pool per object
+		DescriptorAllocator& descriptorAllocator() const;
+		//where anything a frame in flight may still use goes instead of being destroyed right away
+		DeletionQueue& deletionQueue() const;
+
 		void cleanUp();
 
 		void waitIdle();
@@ -39,6 +73,21 @@ namespace vkl
 
 		VmaAllocator _allocator;
 
+		std::unique_ptr<DescriptorAllocator> _descriptorAllocator;
+		std::unique_ptr<DeletionQueue> _deletionQueue;
+
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR _cmdPushDescriptorSetWithTemplate{ nullptr };
+		uint32_t _maxPushDescriptors{ 0 };
+		VkDeviceSize _minUniformBufferOffsetAlignment{ 256 };
+		uint32_t _maxDynamicUniformBuffers{ 8 };
+		bool _bindlessSupported{ false };
+		uint32_t _maxBindlessTextures{ 0 };
+		bool _drawIndirectFirstInstance{ false };
+		bool _multiDrawIndirect{ false };
+		PFN_vkCmdDrawIndexedIndirectCountKHR _cmdDrawIndexedIndirectCount{ nullptr };
+		PFN_vkCmdBeginConditionalRenderingEXT _cmdBeginConditionalRendering{ nullptr };
+		PFN_vkCmdEndConditionalRenderingEXT _cmdEndConditionalRendering{ nullptr };
+
 	};
 
 }
\ No newline at end of file
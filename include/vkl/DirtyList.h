@@ -0,0 +1,91 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace vkl
+{
+	class DirtyList;
+
+	//word at a time hash of a buffer's bytes, for skipping uploads of data that did not change
+	VKL_EXPORT uint64_t contentHash(const void* data, size_t size);
+
+	//hash of the bytes last handed to a buffer, tells a rewrite of the same data from a change
+	class VKL_EXPORT ContentHash
+	{
+	public:
+		//true when data hashes like last time, remembers it either way
+		bool unchanged(const void* data, size_t size);
+		//the bytes were changed in place, the next check can't match
+		void reset();
+
+	private:
+		uint64_t _hash{ 0 };
+		size_t _size{ 0 };
+		bool _valid{ false };
+	};
+
+	//something a DirtyList can queue, the links live in the object so queueing never allocates
+	class VKL_EXPORT DirtyNode
+	{
+	public:
+		DirtyNode() = default;
+		virtual ~DirtyNode();
+		DirtyNode(const DirtyNode&) = delete;
+		DirtyNode& operator=(const DirtyNode&) = delete;
+
+		bool queued() const;
+
+	protected:
+		//queues on the attached list, nothing when already queued or not attached
+		//any thread may call it, the node's own data must not be written while the list flushes though
+		void markDirty();
+
+	private:
+		friend class DirtyList;
+
+		//does this frame's part of the pending work, true while some frame still has work left
+		virtual bool flushDirty(const Device& device, const SwapChain& swapChain) = 0;
+
+		DirtyList* _dirtyList{ nullptr };
+		DirtyNode* _dirtyPrev{ nullptr };
+		DirtyNode* _dirtyNext{ nullptr };
+		std::atomic<bool> _queued{ false };
+	};
+
+	//intrusive list of the nodes with pending updates, so a frame's cost follows what changed instead of how many nodes exist
+	//nodes keep a pointer to it, detach them before it goes away
+	//queueing is locked, nodes of different threads (parallel RenderObject::update) share one list
+	class VKL_EXPORT DirtyList
+	{
+	public:
+		DirtyList() = default;
+		~DirtyList();
+		DirtyList(const DirtyList&) = delete;
+		DirtyList& operator=(const DirtyList&) = delete;
+
+		//node's changes queue it here from now on, it is queued once right away
+		void attach(DirtyNode& node);
+		void detach(DirtyNode& node);
+
+		//flushes every queued node in the order they were queued, the ones with nothing left leave the list
+		void flush(const Device& device, const SwapChain& swapChain);
+
+		size_t size() const;
+
+	private:
+		friend class DirtyNode;
+
+		//locks, for DirtyNode::markDirty
+		void queue(DirtyNode& node);
+		//callers hold _mutex
+		void push(DirtyNode& node);
+		void unlink(DirtyNode& node);
+
+		mutable std::mutex _mutex;
+		DirtyNode* _head{ nullptr };
+		DirtyNode* _tail{ nullptr };
+		size_t _size{ 0 };
+	};
+}
@@ -9,17 +9,44 @@ namespace vkl
 		DrawCall() = default;
 		~DrawCall() = default;
 
-		std::shared_ptr<const IndexBuffer> indexBuffer() const;
+		const std::shared_ptr<const IndexBuffer>& indexBuffer() const;
 		size_t count() const;
 		size_t offset() const;
+		int32_t vertexOffset() const;
+		//from the index buffer, uint32 without one
+		VkIndexType indexType() const;
+		size_t instanceCount() const;
+		size_t firstInstance() const;
 
 		void setIndexBuffer(std::shared_ptr<const IndexBuffer> buffer);
 		void setCount(size_t count);
 		void setOffset(size_t offset);
+		//added to every index before fetching vertices, lets 16 bit indices address a range further into the vertex buffer
+		void setVertexOffset(int32_t vertexOffset);
+		//instance rate vertex bindings advance once per instance
+		void setInstanceCount(size_t instanceCount);
+		void setFirstInstance(size_t firstInstance);
+
+		//draws the culler's commands [firstDraw, firstDraw + drawCount) instead, count/offset/instances come from the gpu
+		//needs an index buffer, the culler's visible instances go in through RenderObject::addCulledInstances
+		void setIndirect(std::shared_ptr<const GpuCuller> culler, uint32_t firstDraw, uint32_t drawCount);
+		const std::shared_ptr<const GpuCuller>& indirect() const;
+		uint32_t indirectFirstDraw() const;
+		uint32_t indirectDrawCount() const;
+
+		//bumped by every setter, RenderObject rebuilds its packet when it moves
+		uint64_t packetVersion() const;
 
 	private:
 		std::shared_ptr<const IndexBuffer> _indexBuffer;
 		size_t _offset{ 0 };
 		size_t _count{ 0 };
+		int32_t _vertexOffset{ 0 };
+		size_t _instanceCount{ 1 };
+		size_t _firstInstance{ 0 };
+		std::shared_ptr<const GpuCuller> _indirect;
+		uint32_t _indirectFirstDraw{ 0 };
+		uint32_t _indirectDrawCount{ 0 };
+		uint64_t _packetVersion{ 1 };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <type_traits>
+
+namespace vkl
+{
+	//vulkan guarantees at least this many vertex input bindings
+	constexpr size_t MaxPacketVertexBuffers = 16;
+
+	struct PacketDraw
+	{
+		VkBuffer indexBuffer;
+		VkIndexType indexType;
+		uint32_t count;
+		uint32_t offset;
+		int32_t vertexOffset;
+		uint32_t instanceCount;
+		uint32_t firstInstance;
+		//gpu generated, count is then the max number of VkDrawIndexedIndirectCommands at indirectOffset
+		VkBuffer indirectBuffer;
+		//when set the actual number of commands is read from here
+		VkBuffer countBuffer;
+		VkDeviceSize indirectOffset;
+	};
+
+	//everything needed to record one RenderObject for one frame as plain handles, recording it is a flat walk
+	struct DrawPacket
+	{
+		VkPipeline pipeline;
+		VkPipelineLayout layout;
+		VkDescriptorSet descriptorSet;
+		//one per uniform in binding order for Pipeline::usesDynamicUniforms, owned by the object like pushDescriptorData
+		const uint32_t* dynamicOffsets;
+		uint32_t dynamicOffsetCount;
+		//set 0 pushed through a template instead of bound when pushDescriptorData is set
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR pushDescriptors;
+		VkDescriptorUpdateTemplate pushTemplate;
+		const void* pushDescriptorData;
+		//BindlessTextureTable set, bound at BindlessTextureSet
+		VkDescriptorSet bindlessSet;
+		//for draws with a countBuffer
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndirectCount;
+		const void* pushConstantData;
+		uint32_t pushConstantSize;
+		uint32_t vertexBufferCount;
+		//range in whatever PacketDraw array the packet was compiled into
+		uint32_t firstDraw;
+		uint32_t drawCount;
+		VkBuffer vertexBuffers[MaxPacketVertexBuffers];
+		VkDeviceSize vertexOffsets[MaxPacketVertexBuffers];
+	};
+	static_assert(std::is_trivially_copyable_v<DrawPacket> && std::is_trivially_copyable_v<PacketDraw>);
+
+	//what is currently bound in one command buffer, binds matching it are dropped
+	class VKL_EXPORT CommandStateTracker
+	{
+	public:
+		//after beginning the buffer, or after anything else recorded into it
+		void reset();
+
+		void record(VkCommandBuffer buffer, const DrawPacket& packet, const PacketDraw* draws, const VkExtent2D& extent);
+
+		//binds/sets recorded and dropped since construction, reset() keeps them
+		uint32_t issued() const;
+		uint32_t skipped() const;
+	private:
+		VkPipeline _pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout _layout{ VK_NULL_HANDLE };
+		VkDescriptorSet _descriptorSet{ VK_NULL_HANDLE };
+		VkPipelineLayout _bindlessLayout{ VK_NULL_HANDLE };
+		VkDescriptorSet _bindlessSet{ VK_NULL_HANDLE };
+		VkBuffer _indexBuffer{ VK_NULL_HANDLE };
+		VkIndexType _indexType{ VK_INDEX_TYPE_UINT32 };
+		bool _scissorSet{ false };
+		VkExtent2D _scissor{};
+		uint32_t _vertexBufferCount{ 0 };
+		VkBuffer _vertexBuffers[MaxPacketVertexBuffers]{};
+		VkDeviceSize _vertexOffsets[MaxPacketVertexBuffers]{};
+
+		uint32_t _issued{ 0 };
+		uint32_t _skipped{ 0 };
+	};
+
+	//standalone record with a fresh tracker, only state repeated inside the packet is dropped
+	VKL_EXPORT void recordDrawPacket(VkCommandBuffer buffer, const DrawPacket& packet, const PacketDraw* draws, const VkExtent2D& extent);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <vkl/Common.h>
+
+namespace vkl
+{
+	//(normal, distance) per plane, a point is inside when dot(normal, p) + distance >= 0 for all six
+	struct CullFrustum
+	{
+		float planes[6][4];
+	};
+
+	//bounding spheres as separate arrays so the kernel can load a register's worth at once
+	struct CullSpheres
+	{
+		const float* x{ nullptr };
+		const float* y{ nullptr };
+		const float* z{ nullptr };
+		const float* radius{ nullptr };
+		size_t count{ 0 };
+	};
+
+	//visible[i] = 1 if sphere i touches the frustum else 0, returns how many do
+	//8 spheres a step with avx, 4 with sse, one at a time otherwise
+	VKL_EXPORT size_t cullSpheres(const CullFrustum& frustum, const CullSpheres& spheres, uint8_t* visible);
+}
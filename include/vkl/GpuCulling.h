@@ -0,0 +1,109 @@
+#pragma once
+#include <vkl/Common.h>
+#include <vkl/FrustumCulling.h>
+
+#include <type_traits>
+
+namespace vkl
+{
+	//one culled instance, transform is what lands in the visible instance buffer when its world space sphere passes
+	struct CullInstance
+	{
+		float transform[16];
+		float center[3];
+		float radius;
+		uint32_t draw;
+		uint32_t padding[3];
+	};
+	static_assert(sizeof(CullInstance) == 96 && std::is_trivially_copyable_v<CullInstance>);
+
+	//one indexed draw the instances are sorted into, becomes a VkDrawIndexedIndirectCommand
+	struct CullDraw
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+	};
+
+	//compute pass that frustum culls instances on the gpu and writes the indirect draws for them
+	//each draw's visible instances are packed at its firstInstance in visibleInstanceBuffer, 64 byte matrices for an instance rate binding
+	class VKL_EXPORT GpuCuller
+	{
+	public:
+		static constexpr uint32_t CommandStride = sizeof(VkDrawIndexedIndirectCommand);
+
+		GpuCuller() = delete;
+		GpuCuller(const Device& device, const SwapChain& swapChain);
+		~GpuCuller() = default;
+		GpuCuller(const GpuCuller&) = delete;
+		GpuCuller& operator=(const GpuCuller&) = delete;
+
+		void setDraws(std::span<const CullDraw> draws);
+		//every instance's draw has to index into the draws
+		void setInstances(std::span<const CullInstance> instances);
+		void setFrustum(const CullFrustum& frustum);
+
+		uint32_t drawCount() const;
+		uint32_t instanceCount() const;
+
+		//uploads this frame's inputs, CommandDispatcher calls it for registered cullers
+		void update(const Device& device, const SwapChain& swapChain);
+		//outside of a render pass, leaves the outputs ready for indirect and vertex input reads
+		void recordCull(VkCommandBuffer buffer, size_t frame) const;
+
+		//one command per draw, instanceCount 0 for draws with nothing visible
+		VkBuffer commandBuffer(size_t frame) const;
+		//only the draws with something visible, their number is in countBuffer
+		VkBuffer compactedCommandBuffer(size_t frame) const;
+		VkBuffer countBuffer(size_t frame) const;
+		VkBuffer visibleInstanceBuffer(size_t frame) const;
+
+		PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const;
+		bool multiDrawIndirect() const;
+
+		//bumped when the draws or a frame's buffers change, what packets drawing from it bake in
+		uint64_t packetVersion() const;
+
+		void cleanUp(const Device& device);
+	private:
+		struct Allocation
+		{
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VmaAllocation memory{ nullptr };
+			void* mapped{ nullptr };
+			size_t size{ 0 };
+		};
+
+		struct FrameData
+		{
+			Allocation instances;
+			Allocation commandTemplate;
+			Allocation commands;
+			Allocation compacted;
+			Allocation count;
+			Allocation visible;
+			VkDescriptorSet set{ VK_NULL_HANDLE };
+			bool dirty{ true };
+		};
+
+		void createPipeline(const Device& device);
+		//per draw template with each draw's instances packed after the previous draw's
+		void buildCommands();
+		void markDirty();
+
+		std::vector<CullDraw> _draws;
+		std::vector<CullInstance> _instances;
+		std::vector<VkDrawIndexedIndirectCommand> _commands;
+		CullFrustum _frustum{};
+
+		std::vector<FrameData> _frames;
+
+		VkDescriptorSetLayout _setLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout _pipelineLayout{ VK_NULL_HANDLE };
+		VkPipeline _pipeline{ VK_NULL_HANDLE };
+
+		PFN_vkCmdDrawIndexedIndirectCountKHR _cmdDrawIndexedIndirectCount{ nullptr };
+		bool _multiDrawIndirect{ false };
+		uint64_t _packetVersion{ 1 };
+	};
+}
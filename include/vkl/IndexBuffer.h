@@ -1,42 +1,77 @@
 #pragma once
 #include <vkl/Common.h>
+#include <vkl/DirtyList.h>
 
 namespace vkl
 {
-	class VKL_EXPORT IndexBuffer
+	class VKL_EXPORT IndexBuffer : public DirtyNode
 	{
 	public:
+		//dirty updates in a row with the data at a quarter of capacity or less before a per frame buffer shrinks
+		static constexpr size_t ShrinkAfterUpdates = 64;
+
 		IndexBuffer() = delete;
-		IndexBuffer(const Device& device, const SwapChain& swapChain);
+		IndexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage = BufferUsage::Dynamic);
 
 		void setData(std::span<const uint32_t> indices);
+		//half the memory and fetch bandwidth, for draws whose vertex range fits, see DrawCall::setVertexOffset
+		void setData(std::span<const uint16_t> indices);
+		//bytes of data() changed in place since setData, only those are copied into each frame's buffer
+		void updateRange(size_t offset, size_t size);
 		void update(const Device& device, const SwapChain& swapChain);
 
 		void* data() const;
 		size_t elementSize() const;
 		size_t count() const;
+		VkIndexType indexType() const;
+		BufferUsage usage() const;
+		//bumped whenever a handle or the index type changes, what a compiled packet bakes in
+		uint64_t packetVersion() const;
+
+		//bytes the frame's buffer can hold before it has to be recreated, per frame buffers grow by doubling
+		size_t capacity(size_t frameIndex) const;
+		//on by default, off keeps per frame buffers at their largest size
+		void setShrinkEnabled(bool enabled);
+		bool shrinkEnabled() const;
+		//off by default, on skips setData calls whose bytes hash the same as the last ones instead of uploading them again
+		void setChangeDetection(bool enabled);
+		bool changeDetection() const;
 
+		//the same buffer for every frame when Static
 		VkBuffer handle(size_t frameIndex) const;
 
 		bool isValid(size_t frameIndex) const;
 
 		void cleanUp(const Device& device);
 	private:
+		void setData(const void* data, size_t elementSize, size_t count);
+
 		void* _data{ nullptr };
 		size_t _elementSize{ 0 };
 		size_t _count{ 0 };
-		size_t _oldCount{ 0 };
+		BufferUsage _usage{ BufferUsage::Dynamic };
+		bool _shrinkEnabled{ true };
+		bool _changeDetection{ false };
+		uint64_t _packetVersion{ 1 };
+		ContentHash _contentHash;
+
+		void updateStatic(const Device& device, const SwapChain& swapChain);
+		bool flushDirty(const Device& device, const SwapChain& swapChain) override;
 
 		struct BufferInfo
 		{
 			VkBuffer _buffer{ VK_NULL_HANDLE };
 			VmaAllocation _memory{ nullptr };
 			void* _mapped{ nullptr };
+			size_t _capacity{ 0 };
+			size_t _smallUpdates{ 0 };
 		};
 
+		//one per frame in flight, just one when Static
 		std::vector<BufferInfo> _buffers;
 
-		int _dirty{ -1 };
+		//per frame in flight, what still has to reach that frame's buffer
+		std::vector<DirtyRanges> _dirties;
 
 	};
 }
\ No newline at end of file
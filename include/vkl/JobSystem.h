@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vkl/Common.h>
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+
+namespace vkl
+{
+	struct JobSystemOptions
+	{
+		//-1 = hardware_concurrency - 1, 0 = everything runs on the submitting thread
+		int32_t workerCount = -1;
+		//failed steal attempts before a worker goes to sleep, 0 = sleep right away
+		uint32_t spinCount = 1024;
+		//pin worker i to core (firstCore + i) % cores
+		bool pinWorkers = false;
+		uint32_t firstCore = 1;
+		//non-worker threads (main thread, loaders...) that get their own deque
+		uint32_t externalThreadSlots = 8;
+	};
+
+	struct Job;
+	using JobFunction = void(*)(Job& job);
+
+	//one cache line, allocated from a per thread ring so submitting only hits the heap when every slot is still live
+	struct alignas(64) Job
+	{
+		static constexpr size_t DataSize = 40;
+
+		JobFunction function = nullptr;
+		Job* parent = nullptr;
+		std::atomic<int32_t> unfinished{ 0 };
+		alignas(8) uint8_t data[DataSize];
+	};
+	static_assert(sizeof(Job) == 64);
+
+	class JobQueue;
+
+	class VKL_EXPORT JobSystem
+	{
+	public:
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		//only has an effect before the first call to instance()
+		static bool configure(const JobSystemOptions& options);
+		static JobSystem& instance();
+
+		Job* createJob(JobFunction function, Job* parent = nullptr);
+
+		template <typename T>
+		Job* createJob(JobFunction function, const T& data, Job* parent = nullptr)
+		{
+			static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= Job::DataSize, "job data must be small and trivially copyable");
+			Job* job = createJob(function, parent);
+			std::memcpy(job->data, &data, sizeof(T));
+			return job;
+		}
+
+		template <typename T>
+		static const T& jobData(const Job& job)
+		{
+			return *reinterpret_cast<const T*>(job.data);
+		}
+
+		//lambda must only capture pointers/references/pods, it is copied into the job
+		template <typename F>
+		Job* createClosureJob(const F& func, Job* parent = nullptr)
+		{
+			return createJob([](Job& job) { jobData<F>(job)(); }, func, parent);
+		}
+
+		void run(Job* job);
+		//helps out with other jobs while waiting
+		void wait(const Job* job);
+		bool isComplete(const Job* job) const;
+
+		//func(begin, end) over [0, count) split down to chunks of at most grain
+		template <typename F>
+		void parallelFor(size_t count, size_t grain, const F& func)
+		{
+			if (count == 0)
+				return;
+			ParallelForData<F> data{ &func, 0, count, grain < 1 ? 1 : grain, this };
+			Job* root = createJob(&parallelForJob<F>, data);
+			run(root);
+			wait(root);
+		}
+
+		//workers plus the submitting thread
+		size_t maxConcurrency() const { return _workers.size() + 1; }
+		size_t workerCount() const { return _workers.size(); }
+
+		//stable index of the calling thread in [0, threadSlots()), threads past the external slots share the last one
+		size_t threadIndex();
+		size_t threadSlots() const { return _queues.size() + 1; }
+
+	private:
+		explicit JobSystem(const JobSystemOptions& options);
+
+		template <typename F>
+		struct ParallelForData
+		{
+			const F* func;
+			size_t begin;
+			size_t end;
+			size_t grain;
+			JobSystem* system;
+		};
+
+		template <typename F>
+		static void parallelForJob(Job& job)
+		{
+			ParallelForData<F> data = jobData<ParallelForData<F>>(job);
+			while (data.end - data.begin > data.grain)
+			{
+				size_t mid = data.begin + (data.end - data.begin) / 2;
+				ParallelForData<F> right = data;
+				right.begin = mid;
+				data.system->run(data.system->createJob(&parallelForJob<F>, right, &job));
+				data.end = mid;
+			}
+			(*data.func)(data.begin, data.end);
+		}
+
+		void execute(Job* job);
+		void finish(Job* job);
+		Job* getJob(JobQueue* ownQueue);
+		JobQueue* queueForThisThread();
+		void workerLoop(size_t index);
+		void wakeWorker();
+
+		JobSystemOptions _options;
+		std::vector<std::unique_ptr<JobQueue>> _queues;
+		std::vector<std::thread> _workers;
+		std::atomic<uint32_t> _nextExternalSlot{ 0 };
+		std::atomic<bool> _running{ true };
+		std::atomic<uint32_t> _wakeEpoch{ 0 };
+		std::atomic<uint32_t> _sleepers{ 0 };
+	};
+}
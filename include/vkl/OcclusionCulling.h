@@ -0,0 +1,95 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <array>
+
+namespace vkl
+{
+	//two phase hierarchical-z occlusion culling on the gpu
+	//objects visible last time are drawn first, the depth they leave is reduced into a max hi-z chain, and every tested sphere is checked against it
+	//the results predicate the second phase draws of the same frame (VK_EXT_conditional_rendering) and are read back to pick the first phase of a later one
+	class VKL_EXPORT OcclusionCuller
+	{
+	public:
+		//one uint per tested sphere in predicateBuffer, non zero = visible
+		static constexpr uint32_t PredicateStride = sizeof(uint32_t);
+
+		OcclusionCuller() = delete;
+		//needs conditional rendering and a sampled swap chain depth image
+		OcclusionCuller(const Device& device, const SwapChain& swapChain);
+		~OcclusionCuller() = default;
+		OcclusionCuller(const OcclusionCuller&) = delete;
+		OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+		//column major, the matrix the frame is drawn with, standard 0 near 1 far depth
+		void setViewProjection(const float viewProjection[16]);
+		//world space center and radius, index i's result lands at i * PredicateStride
+		void setSpheres(std::span<const std::array<float, 4>> spheres);
+
+		uint32_t sphereCount() const;
+
+		//(re)builds the hi-z chain when the swap chain's depth image changed and uploads this frame's spheres, CommandDispatcher calls it
+		void update(const Device& device, const SwapChain& swapChain);
+		//after the first pass ended with depth in DEPTH_STENCIL_ATTACHMENT_OPTIMAL, leaves it DEPTH_STENCIL_READ_ONLY_OPTIMAL for RenderPass::resumeHandle
+		void recordBuild(VkCommandBuffer buffer, size_t frame) const;
+
+		VkBuffer predicateBuffer(size_t frame) const;
+		//what the last submit of this frame found, only valid once its fence was waited on and before update
+		std::span<const uint32_t> results(size_t frame) const;
+
+		VkExtent2D hiZExtent() const;
+		uint32_t hiZLevels() const;
+
+		void cleanUp(const Device& device);
+	private:
+		struct Allocation
+		{
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VmaAllocation memory{ nullptr };
+			void* mapped{ nullptr };
+			size_t size{ 0 };
+		};
+
+		struct FrameData
+		{
+			Allocation spheres;
+			Allocation visibility;
+			VkDescriptorSet set{ VK_NULL_HANDLE };
+			uint32_t count{ 0 };
+			//the hi-z chain set was written for
+			uint64_t hiZVersion{ 0 };
+		};
+
+		void createPipelines(const Device& device);
+		void createHiZ(const Device& device, const SwapChain& swapChain);
+		void destroyHiZ(const Device& device);
+
+		std::vector<std::array<float, 4>> _spheres;
+		float _viewProjection[16]{};
+
+		std::vector<FrameData> _frames;
+
+		VkImage _depthImage{ VK_NULL_HANDLE };
+		VkImageView _depthView{ VK_NULL_HANDLE };
+		VkExtent2D _depthExtent{};
+		VkImageAspectFlags _depthAspect{ VK_IMAGE_ASPECT_DEPTH_BIT };
+		uint32_t _samples{ 1 };
+
+		VkImage _hiZ{ VK_NULL_HANDLE };
+		VmaAllocation _hiZMemory{ nullptr };
+		VkImageView _hiZView{ VK_NULL_HANDLE };
+		std::vector<VkImageView> _levelViews;
+		//one per level, level 0 reads the depth image
+		std::vector<VkDescriptorSet> _reduceSets;
+		VkExtent2D _hiZExtent{};
+		uint64_t _hiZVersion{ 0 };
+
+		VkSampler _sampler{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _reduceSetLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout _reduceLayout{ VK_NULL_HANDLE };
+		VkPipeline _reducePipeline{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _testSetLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout _testLayout{ VK_NULL_HANDLE };
+		VkPipeline _testPipeline{ VK_NULL_HANDLE };
+	};
+}
@@ -25,6 +25,7 @@ namespace vkl
 			VkFormat format;
 			size_t size{ 0 };
 			size_t offset{ 0 };
+			VkVertexInputRate inputRate{ VK_VERTEX_INPUT_RATE_VERTEX };
 		};
 
 		struct UniformDescription
@@ -53,7 +54,8 @@ namespace vkl
 		void addShaderSPV(VkShaderStageFlagBits stage, const char* shader);
 		void addShaderSPV(VkShaderStageFlagBits stage, const std::filesystem::path& path);
 
-		void declareVertexAttribute(uint32_t binding, uint32_t location, VkFormat format, size_t bindingSize, size_t locationOffset);
+		//every attribute of a binding must share its input rate
+		void declareVertexAttribute(uint32_t binding, uint32_t location, VkFormat format, size_t bindingSize, size_t locationOffset, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX);
 
 		void declareUniform(uint32_t binding, size_t size);
 		void declarePushConstant(size_t size);
@@ -76,6 +78,18 @@ namespace vkl
 		void setDepthOp(VkCompareOp op);
 		bool blendEnabled() const;
 		void setBlendEnabled(bool enable);
+		//depth tested, unblended pipelines join RenderPassOptions::depthPrePass unless this is turned off, their vertex shader must declare gl_Position invariant
+		bool depthPrePass() const;
+		void setDepthPrePass(bool prePass);
+		//builds what RenderObject::setRenderQueue needs for Mask and Blend objects, a blended variant and a pre-pass variant that keeps the fragment stage
+		bool alphaVariants() const;
+		void setAlphaVariants(bool alphaVariants);
+		//for objects whose bindings change every frame, set 0 is pushed while recording when VK_KHR_push_descriptor is there
+		bool pushDescriptors() const;
+		void setPushDescriptors(bool push);
+		//adds BufferManager's bindless texture table at set 1 (BindlessTextureSet)
+		bool bindlessTextures() const;
+		void setBindlessTextures(bool bindless);
 	private:
 		std::vector< ShaderDescription> _shaders;
 		std::vector<VertexAttributeDescription> _attributes;
@@ -85,6 +99,10 @@ namespace vkl
 		VkPrimitiveTopology _primitiveTopology{ VK_PRIMITIVE_TOPOLOGY_POINT_LIST };
 		bool _depth = true;
 		bool _blend = false;
+		bool _depthPrePass = true;
+		bool _alphaVariants = false;
+		bool _pushDescriptors = false;
+		bool _bindlessTextures = false;
 		VkCompareOp _depthOp = VK_COMPARE_OP_LESS;
 	};
 	/*****************************************************************************************************************/
@@ -101,9 +119,29 @@ namespace vkl
 
 
 		VkPipeline handle() const;
+		//same layout and vertex stage without the fragment stage, null unless the pipeline is in its pass's depth pre-pass
+		VkPipeline depthOnlyHandle() const;
+		//depth only but with the fragment stage, for alpha tested objects in the pre-pass
+		VkPipeline maskDepthOnlyHandle() const;
+		//blending on and depth writes off, null without PipelineDescription::setAlphaVariants
+		VkPipeline blendHandle() const;
 		VkDescriptorSetLayout descriptorSetLayoutHandle() const;
 		VkPipelineLayout pipelineLayoutHandle() const;
 
+		//updates all of set 0 in one call, the data is a VkDescriptorBufferInfo per uniform then a VkDescriptorImageInfo per texture, in description order
+		VkDescriptorUpdateTemplate descriptorTemplateHandle() const;
+		size_t descriptorDataSize() const;
+
+		//set 0 has no sets allocated, it is pushed through the template while recording
+		bool usesPushDescriptors() const;
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate() const;
+
+		//uniforms are UNIFORM_BUFFER_DYNAMIC, bound with each UniformBuffer::offset in binding order, pushed sets keep the offset in the descriptor
+		bool usesDynamicUniforms() const;
+		VkDescriptorType uniformDescriptorType() const;
+
+		bool usesBindlessTextures() const;
+
 		std::type_index type() const;
 
 		void cleanUp(const Device& device);
@@ -112,10 +150,19 @@ namespace vkl
 
 		void createDescriptorSetLayout(const Device& device, const SwapChain& swapChain, const PipelineDescription& description, const RenderPass& renderPass);
 		void createPipeline(const Device& device, const SwapChain& swapChain, const PipelineDescription& description, const RenderPass& renderPass);
+		void createDescriptorTemplate(const Device& device, const PipelineDescription& description);
 
 		VkPipeline _pipeline{ VK_NULL_HANDLE };
+		VkPipeline _depthOnlyPipeline{ VK_NULL_HANDLE };
+		VkPipeline _maskDepthOnlyPipeline{ VK_NULL_HANDLE };
+		VkPipeline _blendPipeline{ VK_NULL_HANDLE };
 		VkPipelineLayout _pipelineLayout{ VK_NULL_HANDLE };
 		VkDescriptorSetLayout _descriptorSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorUpdateTemplate _descriptorTemplate{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _bindlessSetLayout{ VK_NULL_HANDLE };
+		size_t _descriptorDataSize{ 0 };
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR _cmdPushDescriptorSetWithTemplate{ nullptr };
+		bool _dynamicUniforms{ false };
 		std::type_index _type;
 	};
 	/*****************************************************************************************************************/
@@ -59,6 +59,9 @@ namespace vkl
 		PipelineManager(const Device& device, const SwapChain& swapChain, const RenderPass& renderPass);
 
 		const Pipeline* pipelineForType(std::type_index type) const;
+		//stable small id for sort keys, pipelineCount() if the type has no pipeline
+		size_t pipelineIndex(std::type_index type) const;
+		size_t pipelineCount() const;
 
 		void cleanUp(const Device& device);
 	private:
@@ -1,12 +1,26 @@
 #pragma once
 #include <vkl/Common.h>
 #include <vkl/Pipeline.h>
+#include <vkl/DrawPacket.h>
+
+#include <atomic>
+#include <array>
 
 namespace vkl
 {
 	class BufferManager;
 	class PipelineManager;
 
+	//drawn in this order within a sort layer, blended objects back to front
+	enum class RenderQueue : uint8_t
+	{
+		Opaque,
+		//alpha tested
+		Mask,
+		//needs PipelineDescription::setAlphaVariants, otherwise drawn like Opaque
+		Blend
+	};
+
 	class VKL_EXPORT RenderObject
 	{
 	public:
@@ -16,30 +30,169 @@ namespace vkl
 		virtual void recordCommands(const SwapChain& swapChain, const PipelineManager& pipelines, VkCommandBuffer buffer, const VkExtent2D& extent);
 		virtual void updateDescriptors(const Device& device, const SwapChain& swapChain, const PipelineManager& pipelines);
 
+		//appends this frame's packet and its draws for the dispatcher to record, false = record through recordCommands instead
+		//objects overriding recordCommands should override this to return false
+		virtual bool appendDrawPacket(const SwapChain& swapChain, const PipelineManager& pipelines, std::vector<DrawPacket>& packets, std::vector<PacketDraw>& draws);
+		//same for the depth pre-pass, false if the object's pipeline has no depth only variant in this pass
+		//the main pass tests EQUAL against what this lays down, objects overriding recordCommands or appendDrawPacket must override this to match
+		virtual bool appendDepthPacket(const SwapChain& swapChain, const PipelineManager& pipelines, std::vector<DrawPacket>& packets, std::vector<PacketDraw>& draws);
+
 		std::shared_ptr<const PipelineDescription> pipelineDescription() const;
 
+		//descriptor set writes issued by every RenderObject since startup, pushed descriptors aren't writes
+		static uint64_t descriptorWriteCount();
+
+		//layer(8) | queue(2) | pipeline(12) | material(20) | depth(22), lowest key is drawn first
+		//blended objects use layer(8) | queue(2) | far to near depth(32) | pipeline(12) | material(10)
+		virtual uint64_t sortKey(const PipelineManager& pipelines) const;
+
+		//layer(8) | depth(32), front to back for the depth pre-pass
+		uint64_t depthSortKey() const;
+
+		void setRenderQueue(RenderQueue queue);
+		RenderQueue renderQueue() const;
+
+		void setSortLayer(uint8_t layer);
+		uint8_t sortLayer() const;
+
+		//view space distance, orders draws that share layer/pipeline/material
+		void setSortDepth(float depth);
+		float sortDepth() const;
+
+		//world space sphere the dispatcher frustum culls against, objects without one are always drawn
+		void setBoundingSphere(float x, float y, float z, float radius);
+		void clearBoundingSphere();
+		bool hasBoundingSphere() const;
+		//x, y, z, radius
+		const std::array<float, 4>& boundingSphere() const;
+
+		//static objects get their commands cached by the dispatcher and only re-recorded when commandSignature changes
+		void setStatic(bool isStatic);
+		bool isStatic() const;
+
+		//hash of everything recordCommands bakes into a command buffer for the current frame
+		virtual uint64_t commandSignature(const SwapChain& swapChain, const PipelineManager& pipelines, VkFramebuffer frameBuffer, const VkExtent2D& extent) const;
+
+		//unique for the lifetime of the process, unlike the object's address
+		uint64_t objectId() const;
+
+		size_t drawCallCount() const;
+
+		//measured time to record this object in nanoseconds, 0 until it has been recorded once
+		float recordCost() const;
+		void setRecordCost(float nanos);
+
 		void cleanUp(const Device& device);
 	protected:
 		void addVBO(std::shared_ptr<const VertexBuffer> vbo, uint32_t binding);
+		//the culler's visible instance transforms as an instance rate vertex binding, for DrawCall::setIndirect draws
+		void addCulledInstances(std::shared_ptr<const GpuCuller> culler, uint32_t binding);
 		void addUniform(std::shared_ptr<const UniformBuffer> uniform, uint32_t binding);
 		void addTexture(std::shared_ptr<const TextureBuffer>texture, uint32_t binding);
 		void addDrawCall(std::shared_ptr<const DrawCall> draw);
+		//swaps one added with addDrawCall, e.g. for a level of detail
+		void setDrawCall(size_t index, std::shared_ptr<const DrawCall> draw);
 
 		void setPushConstant(std::shared_ptr<const PushConstantBase> pc);
 
+		//for pipelines declared with PipelineDescription::setBindlessTextures
+		void setBindlessTextures(std::shared_ptr<const BindlessTextureTable> table);
+
 		void reset();
+		void updateMaterialHash();
 
 		void initPipeline(const Device& device, const SwapChain& swapChain,const PipelineManager& pipelines);
 	private:
+		//rebuilt only when the object's bindings, the pipelines or something it draws from change
+		struct CompiledPacket
+		{
+			DrawPacket packet{};
+			std::vector<PacketDraw> draws;
+			uint64_t bindingVersion{ 0 };
+			uint64_t sourceVersion{ 0 };
+			const PipelineManager* pipelines{ nullptr };
+			//pipelines' one for this type, saves the lookup per frame
+			const Pipeline* pipeline{ nullptr };
+		};
+
+		const CompiledPacket* compiledPacket(const SwapChain& swapChain, const PipelineManager& pipelines);
+		//the one cached by compiledPacket when it was for pipelines, a lookup otherwise
+		const Pipeline* pipelineFor(size_t frame, const PipelineManager& pipelines) const;
+		//sum of the packet versions of every draw call, buffer and culler bound, they only grow so any change moves it
+		uint64_t sourceVersion() const;
+		//fills the frame's template data, false if a declared binding is missing or not valid yet
+		bool packDescriptorData(size_t frame);
+
 		std::vector<std::pair<uint32_t, std::shared_ptr<const VertexBuffer>>> _vbos;
+		std::vector<std::pair<uint32_t, std::shared_ptr<const GpuCuller>>> _culledInstances;
 		std::vector<std::pair<uint32_t, std::shared_ptr<const UniformBuffer>>> _uniforms;
 		std::vector<std::pair<uint32_t, std::shared_ptr<const TextureBuffer>>> _textures;
 		std::vector<std::shared_ptr<const DrawCall>> _drawCalls;
 
 		std::shared_ptr<const PushConstantBase> _pushConstant;
+		std::shared_ptr<const BindlessTextureTable> _bindlessTextures;
 
 		std::vector<VkDescriptorSet> _descriptorSets;
-		VkDescriptorPool _descriptorPool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _descriptorSetLayout{ VK_NULL_HANDLE };
+
+		static uint64_t nextObjectId();
+
+		uint64_t _objectId{ nextObjectId() };
+		bool _static{ false };
+		//bumped per frame whenever that frame's descriptor set gets written
+		std::vector<uint64_t> _descriptorVersions;
+
+		//what each binding last had written, per frame slot
+		struct BoundUniform
+		{
+			uint32_t binding{ 0 };
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			//always 0 with dynamic uniforms, the offset is bound instead
+			VkDeviceSize offset{ 0 };
+			size_t size{ 0 };
+		};
+		struct BoundTexture
+		{
+			uint32_t binding{ 0 };
+			VkImageView view{ VK_NULL_HANDLE };
+			VkSampler sampler{ VK_NULL_HANDLE };
+		};
+		std::vector<std::vector<BoundUniform>> _boundUniforms;
+		std::vector<std::vector<BoundTexture>> _boundTextures;
+
+		std::shared_ptr<const PipelineDescription> _description;
+		VkDescriptorUpdateTemplate _descriptorTemplate{ VK_NULL_HANDLE };
+		bool _pushDescriptors{ false };
+		//Pipeline::usesDynamicUniforms, the declared uniform bindings in ascending order and each frame's offsets for them
+		bool _dynamicUniforms{ false };
+		std::vector<uint32_t> _dynamicBindings;
+		std::vector<std::vector<uint32_t>> _dynamicOffsets;
+		//packed per frame in the layout Pipeline::descriptorTemplateHandle expects
+		std::vector<std::vector<uint8_t>> _descriptorData;
+		std::vector<uint8_t> _descriptorDataComplete;
+
+		//scratch for batching a frame's writes into one call
+		std::vector<uint32_t> _changedUniforms;
+		std::vector<uint32_t> _changedTextures;
+		std::vector<VkWriteDescriptorSet> _writes;
+		std::vector<VkDescriptorBufferInfo> _bufferInfos;
+		std::vector<VkDescriptorImageInfo> _imageInfos;
+
+		static std::atomic<uint64_t>& descriptorWriteCounter();
+
+		float _recordCost{ 0.f };
+
+		//bumped by anything that changes what goes into a packet
+		uint64_t _bindingVersion{ 1 };
+		std::vector<CompiledPacket> _packets;
+
+		uint8_t _sortLayer{ 0 };
+		RenderQueue _renderQueue{ RenderQueue::Opaque };
+		float _sortDepth{ 0.f };
+		std::array<float, 4> _boundingSphere{ 0.f, 0.f, 0.f, 0.f };
+		bool _hasBoundingSphere{ false };
+		//textures + vertex buffers, objects that share these can share binds
+		uint32_t _materialHash{ 0 };
 
 		bool m_init{ false };
 	};
@@ -8,6 +8,11 @@ namespace vkl
 		//TODO - expand to handle different formats and subpass dependencies
 		VkClearColorValue clearColor = { 0.f, 0.f, 0.f, 1.f };
 		VkClearDepthStencilValue clearDepthStencil = { 1.f, 0 };
+		//opaque objects lay down depth front to back with a depth only pipeline first, then shade with an EQUAL test so every pixel is shaded once
+		//their vertex shaders must declare 'invariant gl_Position;' or the two pipelines' depths may differ and EQUAL drops pixels
+		bool depthPrePass = false;
+		//depth is stored for OcclusionCuller's hi-z, and a second pass that loads everything back is made for the objects it lets through late
+		bool occlusionCulling = false;
 	};
 
 
@@ -21,6 +26,8 @@ namespace vkl
 
 
 		VkRenderPass handle() const;
+		//same attachments loaded instead of cleared, depth comes in read only after the hi-z build, null without RenderPassOptions::occlusionCulling
+		VkRenderPass resumeHandle() const;
 
 		const RenderPassOptions& options() const;
 
@@ -28,6 +35,7 @@ namespace vkl
 
 	private:
 		VkRenderPass _renderPass{ VK_NULL_HANDLE };
+		VkRenderPass _resumePass{ VK_NULL_HANDLE };
 		RenderPassOptions _options;
 	};
 }
\ No newline at end of file
@@ -36,6 +36,11 @@ namespace vkl
 
 		VkFormat imageFormat() const;
 		VkFormat depthFormat() const;
+		//recreated along with the swap chain, depth aspect only view
+		VkImage depthImage() const;
+		VkImageView depthImageView() const;
+		//the depth image can be read by shaders
+		bool depthSampled() const;
 
 		uint32_t graphicsFamilyQueueIndex() const;
 		uint32_t presentFamilyQueueIndex() const;
@@ -49,6 +54,7 @@ namespace vkl
 
 		VkCommandBuffer oneOffCommandBuffer(size_t frame) const;
 
+		//waits until the acquired image's previous submit is done, per frame resources can be reset after this
 		void prepNextFrame(const Device& device, const Surface& surface, const CommandDispatcher& commands, const RenderPass& compatiblePass, const WindowSize& targetExtent);
 		void swap(const Device& device, const Surface& surface, const CommandDispatcher& commands, const RenderPass& compatiblePass, const WindowSize& targetExtent);
 
@@ -81,6 +87,7 @@ namespace vkl
 		VkImage _depthImage;
 		VmaAllocation _depthImageMemory;
 		VkImageView _depthImageView;
+		bool _depthSampled{ false };
 
 		std::vector<VkSemaphore> _imageAvailableSemaphores;
 		std::vector<VkSemaphore> _renderFinishedSemaphores;
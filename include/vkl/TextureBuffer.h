@@ -35,23 +35,23 @@ namespace vkl
 		VkImageView imageViewHandle() const;
 		VkSampler samplerHandle() const;
 
+		//slot in the BufferManager's bindless table, NoBindlessIndex when bindless is off
+		uint32_t bindlessIndex() const;
+
 		void cleanUp(const Device& device);
-		void update(const Device& device, const SwapChain& swapChain);
 
 	private:
+		friend class BufferManager;
+
 		const void* _data{ nullptr };
 		size_t _width{ 0 };
 		size_t _height{ 0 };
 		size_t _components{ 0 };
 
-		size_t _createFrame{ 0 };
-		VkBuffer _stagingBuffer{ VK_NULL_HANDLE };
-		VmaAllocation _stagingMemory{ };
-		bool _seenFirstUpdate{ false };
-
 		VkImage _image{ VK_NULL_HANDLE };
 		VmaAllocation _memory{  };
 		VkImageView _imageView{ VK_NULL_HANDLE };
 		VkSampler _sampler{ VK_NULL_HANDLE };
+		uint32_t _bindlessIndex{ ~0u };
 	};
 }
\ No newline at end of file
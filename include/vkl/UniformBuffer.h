@@ -1,24 +1,40 @@
 #pragma once
 #include <vkl/Common.h>
+#include <vkl/UniformRing.h>
+#include <vkl/DirtyList.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
 
 namespace vkl
 {
-	class VKL_EXPORT UniformBuffer
+	class VKL_EXPORT UniformBuffer : public DirtyNode
 	{
 		public:
 			UniformBuffer() = delete;
-			UniformBuffer(const Device& device, const SwapChain& swapChain);
+			//each frame's copy is a slot in ring, BufferManager passes its own
+			UniformBuffer(const Device& device, const SwapChain& swapChain, std::shared_ptr<UniformRing> ring);
 
 			void setData(void* data, size_t size);
+			//bytes of data() changed in place since setData, only those are copied into each frame's slot
+			void updateRange(size_t offset, size_t size);
 			void update(const Device& device, const SwapChain& swapChain);
 
 			void* data() const;
 			size_t size() const;
 
+			//the ring page the frame's slot lives in, shared with other uniforms
 			VkBuffer handle(size_t frameIndex) const;
+			//where the frame's data starts in handle, bound as a dynamic offset
+			VkDeviceSize offset(size_t frameIndex) const;
 
 			bool isValid(size_t frameIndex) const;
 
+			//off by default, on skips setData calls whose bytes hash the same as the last ones instead of uploading them again
+			void setChangeDetection(bool enabled);
+			bool changeDetection() const;
+
 			void cleanUp(const Device& device);
 
 		private:
@@ -26,17 +42,16 @@ namespace vkl
 			size_t _size{ 0 };
 
 			void updateBuffer(const Device& device, size_t frame);
+			bool flushDirty(const Device& device, const SwapChain& swapChain) override;
 
-			struct BufferInfo
-			{
-				VkBuffer _buffer{ VK_NULL_HANDLE };
-				VmaAllocation _memory{ nullptr };
-				void* _mapped{ nullptr };
-			};
+			bool _changeDetection{ false };
+			ContentHash _contentHash;
 
-			std::vector<BufferInfo> _buffers;
+			std::shared_ptr<UniformRing> _ring;
+			std::vector<UniformRing::Slot> _slots;
 
-			std::vector<bool> _dirties;
+			//per frame in flight, what still has to reach that frame's slot
+			std::vector<DirtyRanges> _dirties;
 	};
 
 		template <typename T>
@@ -44,7 +59,7 @@ namespace vkl
 		{
 		public:
 			TypedUniform() = delete;
-			TypedUniform(const Device& device, const SwapChain& swapChain) : UniformBuffer(device, swapChain) {}
+			TypedUniform(const Device& device, const SwapChain& swapChain, std::shared_ptr<UniformRing> ring) : UniformBuffer(device, swapChain, ring) {}
 
 			void setData(const T& data)
 			{
@@ -52,6 +67,19 @@ namespace vkl
 				UniformBuffer::setData((void*)&_ourData, sizeof(T));
 			}
 
+			//copies and uploads only [offset, offset + size) of data, e.g. the joints an animation actually moved
+			void setData(const T& data, size_t offset, size_t size)
+			{
+				if (UniformBuffer::data() != &_ourData || offset >= sizeof(T))
+				{
+					setData(data);
+					return;
+				}
+				size = std::min(size, sizeof(T) - offset);
+				memcpy((char*)&_ourData + offset, (const char*)&data + offset, size);
+				updateRange(offset, size);
+			}
+
 		private:
 			T _ourData{};
 	};
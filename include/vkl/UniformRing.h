@@ -0,0 +1,63 @@
+#pragma once
+#include <vkl/Common.h>
+
+#include <unordered_map>
+
+namespace vkl
+{
+	//persistently mapped uniform memory, one arena per frame in flight that UniformBuffers take aligned slots out of
+	//a slot keeps its page and offset until it is released, so updating a uniform is a memcpy into the frame it is for
+	//pages are bound as UNIFORM_BUFFER_DYNAMIC, a slot's offset goes in at bind time instead of into the descriptor
+	class VKL_EXPORT UniformRing
+	{
+	public:
+		static constexpr VkDeviceSize PageSize = 256 * 1024;
+
+		struct Slot
+		{
+			uint32_t page{ UINT32_MAX };
+			VkDeviceSize offset{ 0 };
+			//rounded up to the alignment
+			VkDeviceSize size{ 0 };
+
+			bool valid() const { return page != UINT32_MAX; }
+		};
+
+		UniformRing() = delete;
+		UniformRing(const Device& device, const SwapChain& swapChain);
+		~UniformRing() = default;
+		UniformRing(const UniformRing&) = delete;
+		UniformRing& operator=(const UniformRing&) = delete;
+
+		//only once the frame's fence was waited on, reused slots may still be read by its last submit before that
+		Slot allocate(const Device& device, size_t frame, VkDeviceSize size);
+		void release(size_t frame, const Slot& slot);
+
+		VkBuffer buffer(size_t frame, const Slot& slot) const;
+		void* mapped(size_t frame, const Slot& slot) const;
+
+		VkDeviceSize alignment() const;
+		size_t pageCount(size_t frame) const;
+
+		void cleanUp(const Device& device);
+	private:
+		struct Page
+		{
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VmaAllocation memory{ nullptr };
+			uint8_t* mapped{ nullptr };
+			VkDeviceSize size{ 0 };
+			VkDeviceSize used{ 0 };
+		};
+
+		struct Frame
+		{
+			std::vector<Page> pages;
+			//released slots by size, uniforms of one type keep trading the same slots
+			std::unordered_map<VkDeviceSize, std::vector<Slot>> free;
+		};
+
+		std::vector<Frame> _frames;
+		VkDeviceSize _alignment{ 256 };
+	};
+}
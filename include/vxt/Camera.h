@@ -2,6 +2,7 @@
 
 #include <vxt/LinearAlgebra.h>
 #include <vxt/VXT_EXPORT.h>
+#include <vkl/FrustumCulling.h>
 #include <array>
 #include <span>
 
@@ -34,6 +35,11 @@ namespace vxt
 		glm::mat4 projection() const;
 		void setProjection(const glm::mat4& projection);
 
+		//world space (normal, distance) planes of projection * view, left right bottom top near far, normals point inwards
+		std::array<glm::vec4, 6> frustumPlanes() const;
+		//same planes for CommandDispatcher::setCullFrustum and GpuCuller::setFrustum
+		vkl::CullFrustum cullFrustum() const;
+
 		glm::vec4 viewport() const;
 		void setViewport(const glm::vec4& viewport);
 
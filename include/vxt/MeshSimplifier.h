@@ -0,0 +1,14 @@
+#pragma once
+#include <vxt/VXT_EXPORT.h>
+#include <vxt/LinearAlgebra.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace vxt
+{
+	//quadric error edge collapse down to roughly targetIndexCount, vertices only ever move onto each other so result indexes the same vertices
+	//open borders and vertices sharing a position with another (uv or normal seams) stay put, so it can stop short of the target
+	//returns how far the surface moved, an upper bound in the units of positions
+	VXT_EXPORT float simplifyMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, size_t targetIndexCount, std::vector<uint32_t>& result);
+}
@@ -13,6 +13,8 @@ https://github.com/SaschaWillems/Vulkan-glTF-PBR
 #include <vkl/Common.h>
 #include <vkl/TextureBuffer.h>
 #include <memory>
+#include <limits>
+#include <vector>
 #include <vkl/DrawCall.h>
 #include <vxt/AssetFactory.h>
 
@@ -23,6 +25,9 @@ namespace vxt
 
 	constexpr size_t MaxNumMorphTargets = 4;
 
+	//full detail plus up to three simplified levels
+	constexpr size_t MaxNumLods = 4;
+
 	class VXT_EXPORT Model : public DeviceAsset
 	{
 	public:
@@ -55,12 +60,54 @@ namespace vxt
 
 		using MorphTargetArray = std::array<std::vector<MorphVertex>, MaxNumMorphTargets>;
 
+		//axis aligned, empty while min > max
+		struct Bounds
+		{
+			glm::vec3 min{ std::numeric_limits<float>::max() };
+			glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+			bool empty() const { return min.x > max.x; }
+			void expand(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+			void expand(const Bounds& other) { if (!other.empty()) { expand(other.min); expand(other.max); } }
+			Bounds transformed(const glm::mat4& transform) const;
+			//center, radius
+			glm::vec4 sphere() const;
+		};
+
+		//bind pose bounds of the vertices one joint moves
+		struct JointBounds
+		{
+			uint32_t joint{ 0 };
+			Bounds bounds;
+		};
+
+		//a simplified version of a primitive's draw, same vertices and index buffer
+		struct Lod
+		{
+			std::shared_ptr<const vkl::DrawCall> draw;
+			//how far it strays from the full mesh, mesh space
+			float error{ 0.f };
+		};
+
 		struct Primitive
 		{
 			std::shared_ptr<const vkl::DrawCall> draw;
 			glm::mat4 transform{ glm::identity<glm::mat4>() };
 			int material{ -1 };
 			glm::vec4 morphWeights{ glm::zero<glm::vec4>() };
+			//mesh space, before transform, grown to cover the morph targets
+			Bounds bounds;
+			//empty for primitives without a skin
+			std::vector<JointBounds> jointBounds;
+			//coarser and coarser, empty when the primitive was too small or didn't simplify
+			std::vector<Lod> lods;
+
+			//0 for draw, i for lods[i - 1], the coarsest whose error stays under maxPixelError once multiplied by pixelsPerUnit (screen pixels per mesh space unit)
+			size_t selectLod(float pixelsPerUnit, float maxPixelError) const;
+			std::shared_ptr<const vkl::DrawCall> lodDraw(size_t lod) const;
+
+			//mesh space bounds for the shape's current animation state, joints as returned by Model::animate
+			Bounds animatedBounds(const JointArray& joints, size_t jointCount) const;
 		};
 
 		Model() = default;
@@ -76,8 +123,11 @@ namespace vxt
 		virtual const MorphTargetArray& getMorphTargets() const = 0;
 		virtual const std::array<std::shared_ptr<const vkl::VertexBuffer>, MaxNumMorphTargets>& getMorphTargetBuffers() const = 0;
 
+		//indices are relative to each draw's vertexOffset, a primitive's draw uses whichever buffer its vertex count allows
 		virtual std::span<const uint32_t> getIndices() const = 0;
 		virtual std::shared_ptr<const vkl::IndexBuffer> getIndexBuffer() const = 0;
+		virtual std::span<const uint16_t> getIndices16() const = 0;
+		virtual std::shared_ptr<const vkl::IndexBuffer> getIndexBuffer16() const = 0;
 
 		virtual std::span<const Primitive> getPrimitives() const = 0;
 		virtual std::span<const Material> getMaterials() const = 0;
@@ -6,6 +6,8 @@
 #include <vkl/UniformBuffer.h>
 #include <vxt/VXT_EXPORT.h>
 #include <vkl/PipelineFactory.h>
+#include <vkl/DrawCall.h>
+#include <vkl/GpuCulling.h>
 #include <vxt/Camera.h>
 
 namespace vxt
@@ -29,12 +31,20 @@ namespace vxt
 		void setShape(const vkl::Device& device, const vkl::SwapChain& swapChain, std::shared_ptr<const Model> model, size_t index);
 		size_t getShape() const;
 
-		void update(const vkl::Device& device, const vkl::SwapChain& swapChain, const glm::mat4& modelMatrix, const Camera& cam, std::shared_ptr<const Model> model,
-			std::string_view animationName, double animationInput);
+		//largest screen space error in pixels a level of detail may show, 0 keeps full detail
+		void setLodPixelError(float pixels);
+		float lodPixelError() const;
+		//level picked by the last update, see Model::Primitive::selectLod
+		size_t lod() const;
 
+		//totals since startup across every shape like RenderObject::descriptorWriteCount, diff them per frame
+		static uint64_t lodSwitchCount();
+		static uint64_t lodSelectionCount(size_t lod);
 
-	private:
+		void update(const vkl::Device& device, const vkl::SwapChain& swapChain, const glm::mat4& modelMatrix, const Camera& cam, std::shared_ptr<const Model> model,
+			std::string_view animationName, double animationInput);
 
+		//uniform blocks, shared with InstancedModelShapeObject
 		struct MVP
 		{
 			glm::mat4 model{ glm::identity<glm::mat4>() };
@@ -69,15 +79,32 @@ namespace vxt
 			alignas(4) float alphaMode_blend = 0.0f;
 		};
 
+		//the blocks every update rewrites and their buffers
+		struct ShapeUniforms
+		{
+			MVP transform;
+			Joints joints;
+			Lights lights;
+			std::shared_ptr<vkl::TypedUniform<MVP>> transformUniform;
+			std::shared_ptr<vkl::TypedUniform<Joints>> jointsUniform;
+			std::shared_ptr<vkl::TypedUniform<Lights>> lightsUniform;
+		};
+
+	protected:
+		friend class InstancedModelShapeObject;
+
+		//camera, skinning and lights for one shape, what both shape objects do every update, returns the shape origin's distance from the eye for sorting
+		static float updateUniforms(ShapeUniforms& uniforms, const glm::mat4& modelMatrix, const Camera& cam, const Model& model, size_t shapeIndex,
+			std::string_view animationName, double animationInput);
+
+	private:
+
 		size_t _shapeIndex{ 0 };
-		MVP _transform;
-		Joints _joints;
-		Lights _lights;
+		size_t _lod{ 0 };
+		float _lodPixelError{ 1.f };
+		ShapeUniforms _uniforms;
 		PBRMaterial _material;
 
-		std::shared_ptr<vkl::TypedUniform<MVP>> _uniform;
-		std::shared_ptr<vkl::TypedUniform<Joints>> _jointsUniform;
-		std::shared_ptr<vkl::TypedUniform<Lights>> _lightsUniform;
 		std::shared_ptr<vkl::TypedUniform<PBRMaterial>> _materialUniform;
 	};
 
@@ -111,4 +138,97 @@ namespace vxt
 		std::string _animationName;
 		double _animationInput{ 0 };
 	};
+
+	//every copy of one primitive in a single instanced draw, per copy transforms come from an instance rate vertex buffer
+	//copies share one animation state and morph targets are not applied
+	class VXT_EXPORT InstancedModelShapeObject : public vkl::RenderObject
+	{
+		PIPELINE_TYPE
+	public:
+		static void describePipeline(vkl::PipelineDescription& description);
+
+		InstancedModelShapeObject() = delete;
+		InstancedModelShapeObject(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager);
+		~InstancedModelShapeObject() = default;
+		InstancedModelShapeObject(const InstancedModelShapeObject&) = delete;
+		InstancedModelShapeObject& operator=(const InstancedModelShapeObject&) = delete;
+		InstancedModelShapeObject(InstancedModelShapeObject&&) noexcept = default;
+		InstancedModelShapeObject& operator=(InstancedModelShapeObject&&) noexcept = default;
+
+		void setShape(const vkl::Device& device, const vkl::SwapChain& swapChain, std::shared_ptr<const Model> model, size_t index);
+		size_t getShape() const;
+
+		void setInstances(std::span<const glm::mat4> transforms);
+		size_t instanceCount() const;
+
+		//draw the culler's visible instances of one of its draws instead of every transform, null to go back, takes effect on setShape
+		void setCulling(std::shared_ptr<const vkl::GpuCuller> culler, uint32_t draw);
+
+		void update(const vkl::Device& device, const vkl::SwapChain& swapChain, const glm::mat4& modelMatrix, const Camera& cam, std::shared_ptr<const Model> model,
+			std::string_view animationName, double animationInput);
+
+	private:
+		size_t _shapeIndex{ 0 };
+		ModelShapeObject::ShapeUniforms _uniforms;
+		ModelShapeObject::PBRMaterial _material;
+
+		std::vector<glm::mat4> _instances;
+
+		std::shared_ptr<vkl::VertexBuffer> _instanceBuffer;
+		std::shared_ptr<vkl::DrawCall> _draw;
+		std::shared_ptr<const vkl::GpuCuller> _culler;
+		uint32_t _cullDraw{ 0 };
+		std::shared_ptr<vkl::TypedUniform<ModelShapeObject::PBRMaterial>> _materialUniform;
+	};
+
+	//many copies of one model, one InstancedModelShapeObject per primitive
+	class VXT_EXPORT InstancedModelRenderObject
+	{
+	public:
+		InstancedModelRenderObject() = default;
+		~InstancedModelRenderObject() = default;
+		InstancedModelRenderObject(const InstancedModelRenderObject&) = delete;
+		InstancedModelRenderObject& operator=(const InstancedModelRenderObject&) = delete;
+		InstancedModelRenderObject(InstancedModelRenderObject&&) noexcept = default;
+		InstancedModelRenderObject& operator=(InstancedModelRenderObject&&) noexcept = default;
+
+		void setModel(const vkl::Device& device, const vkl::SwapChain& swapChain, vkl::BufferManager& bufferManager, const vkl::PipelineManager& pipelines, std::shared_ptr<const Model> model);
+		std::shared_ptr<const Model> getModel() const;
+
+		void setInstances(std::span<const glm::mat4> transforms);
+		std::span<const glm::mat4> instances() const;
+
+		void animate(std::string_view animationName, double input);
+		void update(const vkl::Device& device, const vkl::SwapChain& swapChain, const Camera& cam);
+
+		//applied on top of every instance transform
+		glm::mat4 getTransform() const;
+		void setTransform(const glm::mat4& transform);
+
+		std::span<const std::shared_ptr<InstancedModelShapeObject>> shapes() const;
+
+		//frustum culls the copies on the gpu, register every culler with the CommandDispatcher
+		//one per primitive so each shape draws its culler's whole range and gets vkCmdDrawIndexedIndirectCount where supported
+		//a later setModel with more primitives adds cullers, register those too
+		std::span<const std::shared_ptr<vkl::GpuCuller>> enableGpuCulling(const vkl::Device& device, const vkl::SwapChain& swapChain);
+
+		void cleanUp(const vkl::Device& device);
+
+	private:
+		void updateCullInstances();
+
+		std::vector<std::shared_ptr<InstancedModelShapeObject>> _shapes;
+		std::shared_ptr<const Model> _model;
+		std::vector<glm::mat4> _instances;
+		bool _gpuCulling{ false };
+		//indexed by primitive, never shrinks so registered cullers stay valid
+		std::vector<std::shared_ptr<vkl::GpuCuller>> _cullers;
+		//per primitive model space bounding sphere
+		std::vector<glm::vec4> _bounds;
+		std::vector<vkl::CullInstance> _cullInstances;
+		glm::mat4 _transform{ glm::identity<glm::mat4>() };
+
+		std::string _animationName;
+		double _animationInput{ 0 };
+	};
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include <vkl/Common.h>
+
+#include <vkl/Instance.h>
+#include <vkl/Device.h>
+#include <vkl/SwapChain.h>
+#include <vkl/Window.h>
+#include <vkl/Surface.h>
+#include <vkl/RenderObject.h>
+#include <vkl/BufferManager.h>
+#include <vkl/Pipeline.h>
+#include <vkl/RenderPass.h>
+#include <vkl/CommandDispatcher.h>
+#include <vkl/VertexBuffer.h>
+#include <vkl/DrawCall.h>
+#include <vkl/IndexBuffer.h>
+#include <vkl/TextureBuffer.h>
+#include <vkl/UniformBuffer.h>
+#include <vkl/BindlessTextures.h>
+
+#include <vxt/PNGLoader.h>
+#include <vxt/LinearAlgebra.h>
+#include <vkl/PipelineFactory.h>
+#include <iostream>
+
+constexpr const char* VertShader = R"Shader(
+
+#version 450
+
+layout(binding = 0) uniform Plane {
+	vec2 offset;
+	uint textureIndex;
+} u_plane;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
+
+layout(location = 0) out vec2 fragUV;
+
+void main() {
+    gl_Position = vec4(inPosition + u_plane.offset, 0.0, 1.0);
+    fragUV = inUV;
+}
+)Shader";
+constexpr const char* FragShader = R"Shader(
+
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(binding = 0) uniform Plane {
+	vec2 offset;
+	uint textureIndex;
+} u_plane;
+
+//BufferManager's table, every texture it made is in here
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(textures[nonuniformEXT(u_plane.textureIndex)], fragUV);
+}
+)Shader";
+
+struct Vertex
+{
+	glm::vec2 pos;
+	glm::vec2 uv;
+};
+
+struct PlaneData
+{
+	glm::vec2 offset{ 0.f };
+	uint32_t textureIndex{ 0 };
+	uint32_t padding{ 0 };
+};
+
+//picks its texture out of the bindless table by index, nothing texture related in its own set
+class BindlessPlane : public vkl::RenderObject
+{
+	PIPELINE_TYPE
+		static void describePipeline(vkl::PipelineDescription& description)
+	{
+		description.setPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+		description.addShaderGLSL(VK_SHADER_STAGE_VERTEX_BIT, VertShader);
+		description.addShaderGLSL(VK_SHADER_STAGE_FRAGMENT_BIT, FragShader);
+
+		description.declareVertexAttribute(0, 0, VK_FORMAT_R32G32_SFLOAT, sizeof(Vertex), offsetof(Vertex, pos));
+		description.declareVertexAttribute(0, 1, VK_FORMAT_R32G32_SFLOAT, sizeof(Vertex), offsetof(Vertex, uv));
+
+		description.declareUniform(0, sizeof(PlaneData));
+		description.setBindlessTextures(true);
+	}
+
+public:
+	BindlessPlane() = delete;
+	BindlessPlane(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager, const glm::vec2& offset)
+	{
+		auto vbo = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
+
+		_verts.push_back({ glm::vec2(-0.4, -0.4), glm::vec2(0,0) });
+		_verts.push_back({ glm::vec2(-0.4, 0.4), glm::vec2(0,1) });
+		_verts.push_back({ glm::vec2(0.4, 0.4), glm::vec2(1,1) });
+		_verts.push_back({ glm::vec2(0.4, -0.4), glm::vec2(1,0) });
+
+		vbo->setData(_verts.data(), sizeof(Vertex), _verts.size());
+		addVBO(vbo, 0);
+
+		auto drawCall = std::make_shared<vkl::DrawCall>();
+
+		_indices.push_back(0);
+		_indices.push_back(1);
+		_indices.push_back(3);
+		_indices.push_back(3);
+		_indices.push_back(1);
+		_indices.push_back(2);
+		auto indexBuffer = bufferManager.createIndexBuffer(device, swapChain, vkl::BufferUsage::Static);
+		indexBuffer->setData(_indices);
+		drawCall->setCount(_indices.size());
+
+		drawCall->setIndexBuffer(indexBuffer);
+
+		addDrawCall(drawCall);
+
+		_data.offset = offset;
+		_uniform = bufferManager.createTypedUniform<PlaneData>(device, swapChain);
+		_uniform->setData(_data);
+		addUniform(_uniform, 0);
+
+		setBindlessTextures(bufferManager.bindlessTextures());
+	}
+
+	void setTexture(std::shared_ptr<const vkl::TextureBuffer> texture)
+	{
+		//the plane only keeps the index, the texture's slot lives as long as the texture
+		_texture = texture;
+		_data.textureIndex = texture->bindlessIndex();
+		_uniform->setData(_data);
+	}
+
+	std::vector<Vertex> _verts;
+	std::vector<uint32_t> _indices;
+	PlaneData _data;
+	std::shared_ptr<vkl::TypedUniform<PlaneData>> _uniform;
+	std::shared_ptr<const vkl::TextureBuffer> _texture;
+};
+
+REGISTER_PIPELINE(BindlessPlane, BindlessPlane::describePipeline)
+
+std::shared_ptr<vkl::TextureBuffer> loadTexture(const vkl::Device& device, const vkl::SwapChain& swapChain, vkl::BufferManager& bufferManager, const std::string& path, bool png)
+{
+	int width = 0, height = 0, components = 0;
+	void* imageData = png ? vxt::loadPNGData(path.c_str(), width, height, components) : vxt::loadJPGData(path.c_str(), width, height, components);
+	if (!imageData)
+	{
+		std::cerr << "Couldn't load example image!!!";
+		return nullptr;
+	}
+
+	auto texture = bufferManager.createTextureBuffer(device, swapChain, imageData, (size_t)width, (size_t)height, (size_t)components);
+	if (png)
+		vxt::freePNGData(imageData);
+	else
+		vxt::freeJPGData(imageData);
+	return texture;
+}
+
+int main(int argc, char* argv[])
+{
+	vkl::Instance instance("bindless_vkl", true);
+	vkl::Window window(1080, 720, "bindless_vkl");
+	vkl::Surface surface(instance, window);
+	vkl::Device device(instance, surface);
+
+	//every registered pipeline gets built, BindlessPlane's can't be without the table
+	if (!device.bindlessSupported())
+	{
+		std::cerr << "Device doesn't support bindless textures";
+		device.cleanUp();
+		surface.cleanUp(instance);
+		window.cleanUp();
+		instance.cleanUp();
+		vkl::Window::cleanUpWindowSystem();
+		return 0;
+	}
+
+	vkl::SwapChainOptions swapChainOptions{};
+	swapChainOptions.swapChainExtent.width = window.getWindowSize().width;
+	swapChainOptions.swapChainExtent.height = window.getWindowSize().height;
+	vkl::SwapChain swapChain(device, surface, swapChainOptions);
+
+	vkl::RenderPassOptions mainPassOptions;
+	mainPassOptions.clearColor = { 0.f, 0.f, 0.f, 1.f };
+	vkl::RenderPass mainPass(device, swapChain, mainPassOptions);
+
+	swapChain.registerRenderPass(device, mainPass);
+
+	vkl::BufferManager bufferManager(device, swapChain);
+	bufferManager.enableBindlessTextures(device);
+	vkl::PipelineManager pipelineManager(device, swapChain, mainPass);
+
+	vkl::CommandDispatcher commandDispatcher(device, swapChain);
+
+	std::vector<std::shared_ptr<vkl::RenderObject>> renderObjects;
+	auto textureDir = std::filesystem::path(VKL_DATA_DIR) / "textures";
+	auto first = loadTexture(device, swapChain, bufferManager, (textureDir / "texture.jpg").make_preferred().string(), false);
+	auto second = loadTexture(device, swapChain, bufferManager, (textureDir / "kelloggs.PNG").make_preferred().string(), true);
+
+	//same pipeline and set layout for both, only the index in their uniform differs
+	if (first)
+	{
+		auto left = std::make_shared<BindlessPlane>(device, swapChain, pipelineManager, bufferManager, glm::vec2(-0.5f, 0.f));
+		left->setTexture(first);
+		renderObjects.push_back(left);
+	}
+	if (second)
+	{
+		auto right = std::make_shared<BindlessPlane>(device, swapChain, pipelineManager, bufferManager, glm::vec2(0.5f, 0.f));
+		right->setTexture(second);
+		renderObjects.push_back(right);
+	}
+
+	while (!window.shouldClose())
+	{
+		swapChain.prepNextFrame(device, surface, commandDispatcher, mainPass, window.getWindowSize());
+		bufferManager.update(device, swapChain);
+		commandDispatcher.processUnsortedObjects(renderObjects, device, pipelineManager, mainPass, swapChain, swapChain.frameBuffer(swapChain.frame()), swapChain.swapChainExtent());
+		swapChain.swap(device, surface, commandDispatcher, mainPass, window.getWindowSize());
+		window.clearLastFrame();
+		vkl::Window::pollEventsForAllWindows();
+	}
+
+	device.waitIdle();
+	for (auto&& ro : renderObjects)
+		ro->cleanUp(device);
+	renderObjects.clear();
+	first = nullptr;
+	second = nullptr;
+	commandDispatcher.cleanUp(device);
+	pipelineManager.cleanUp(device);
+	bufferManager.cleanUp(device);
+	mainPass.cleanUp(device);
+	swapChain.cleanUp(device);
+	device.cleanUp();
+	surface.cleanUp(instance);
+	window.cleanUp();
+
+	instance.cleanUp();
+	vkl::Window::cleanUpWindowSystem();
+}
@@ -13,18 +13,21 @@
 #include <vkl/VertexBuffer.h>
 #include <vkl/DrawCall.h>
 #include <vkl/IndexBuffer.h>
+#include <vkl/OcclusionCulling.h>
+#include <vkl/JobSystem.h>
 #include <vxt/LinearAlgebra.h>
 #include <vxt/FirstPersonManip.h>
 #include <vxt/Camera.h>
 #include <vxt/Model.h>
 #include <vxt/ModelRenderObject.h>
 
-#include <tbb/parallel_for.h>
-
 constexpr const char* VertShader = R"Shader(
 
 #version 450
 
+//the depth pre-pass draws with the same shader, EQUAL needs bit identical depth
+invariant gl_Position;
+
 layout(push_constant) uniform MVP {
 	mat4 mvp;
 } u_mvp;
@@ -78,7 +81,7 @@ class Axis : public vkl::RenderObject
 public:
 	Axis(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager)
 	{
-		auto vbo = bufferManager.createVertexBuffer(device, swapChain);
+		auto vbo = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
 
 		//x
 		_verts.push_back({ glm::vec3(0.0, 0.0, 0.), glm::vec3(1,0,0) });
@@ -161,6 +164,8 @@ VulkanWindow buildWindow(const vkl::Instance& instance, const std::string& title
 
 	vkl::RenderPassOptions mainPassOptions;
 	mainPassOptions.clearColor = { 0.2f, 0.2f, 0.2f, 1.f };
+	mainPassOptions.depthPrePass = true;
+	mainPassOptions.occlusionCulling = true;
 	vkl::RenderPass mainPass(device, swapChain, mainPassOptions);
 
 	swapChain.registerRenderPass(device, mainPass);
@@ -180,7 +185,7 @@ void updateWindow(VulkanWindow& window)
 {
 	window.swapChain.prepNextFrame(window.device, window.surface, window.commandDispatcher, window.mainPass, window.window.getWindowSize());
 	window.bufferManager.update(window.device, window.swapChain);
-	window.commandDispatcher.processUnsortedObjects(window.renderObjects, window.device, window.pipelineManager, window.mainPass, window.swapChain, window.swapChain.frameBuffer(window.swapChain.frame()), window.swapChain.swapChainExtent());
+	window.commandDispatcher.processSortedObjects(window.renderObjects, window.device, window.pipelineManager, window.mainPass, window.swapChain, window.swapChain.frameBuffer(window.swapChain.frame()), window.swapChain.swapChainExtent());
 	window.swapChain.swap(window.device, window.surface, window.commandDispatcher, window.mainPass, window.window.getWindowSize());
 }
 
@@ -226,23 +231,72 @@ int main(int argc, char* argv[])
 	if (!model)
 		return -1;
 
-	std::vector<std::shared_ptr<vxt::ModelRenderObject>> models;
+	//--instanced draws the copies as one InstancedModelRenderObject sharing one animation state
+	bool instanced = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::string_view(argv[i]) == "--instanced")
+			instanced = true;
+	}
+
 #ifdef NDEBUG
 	constexpr int numModels = 500;
 #else
 	constexpr int numModels = 20;
 #endif
+	std::vector<std::shared_ptr<vxt::ModelRenderObject>> models;
+	std::shared_ptr<vxt::InstancedModelRenderObject> instancedModels;
+	std::vector<glm::mat4> transforms;
 	glm::mat4 transform = glm::identity<glm::mat4>();
 	for (int i = 0; i < numModels; ++i)
 	{
-		auto modelObject = std::make_shared<vxt::ModelRenderObject>();
-		modelObject->setModel(window.device, window.swapChain, window.bufferManager, window.pipelineManager, model);
-		for (auto&& shape : modelObject->shapes())
+		transform[3] = glm::vec4(randomPosition(), 1);
+		transforms.push_back(transform);
+	}
+
+	if (instanced)
+	{
+		//every copy of a primitive goes out in one instanced draw
+		instancedModels = std::make_shared<vxt::InstancedModelRenderObject>();
+		instancedModels->setInstances(transforms);
+		instancedModels->setModel(window.device, window.swapChain, window.bufferManager, window.pipelineManager, model);
+		for (auto&& shape : instancedModels->shapes())
+		{
+			//bindings never change, only uniform contents
+			shape->setStatic(true);
 			window.renderObjects.push_back(shape);
+		}
+		//copies outside the view never reach the vertex shader
+		if (window.device.drawIndirectFirstInstanceSupported())
+		{
+			for (auto&& culler : instancedModels->enableGpuCulling(window.device, window.swapChain))
+				window.commandDispatcher.addCuller(culler);
+		}
+	}
+	else
+	{
+		for (auto&& modelTransform : transforms)
+		{
+			auto modelObject = std::make_shared<vxt::ModelRenderObject>();
+			modelObject->setModel(window.device, window.swapChain, window.bufferManager, window.pipelineManager, model);
+			for (auto&& shape : modelObject->shapes())
+			{
+				//bindings never change, only uniform contents
+				shape->setStatic(true);
+				window.renderObjects.push_back(shape);
+			}
+
+			modelObject->setTransform(modelTransform);
+			models.push_back(modelObject);
+		}
+	}
 
-		transform[3] = glm::vec4(randomPosition(), 1);
-		modelObject->setTransform(transform);
-		models.push_back(modelObject);
+	//whatever the crowd hides is only drawn if this frame's hi-z lets it through
+	std::shared_ptr<vkl::OcclusionCuller> occlusion;
+	if (window.device.cmdBeginConditionalRendering() && window.swapChain.depthSampled())
+	{
+		occlusion = std::make_shared<vkl::OcclusionCuller>(window.device, window.swapChain);
+		window.commandDispatcher.setOcclusionCuller(occlusion);
 	}
 
 	auto axis = std::make_shared<Axis>(window.device, window.swapChain, window.pipelineManager, window.bufferManager);
@@ -260,17 +314,33 @@ int main(int argc, char* argv[])
 		window.manip.process(window.window, window.cam);
 		uint64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 		double seconds = (double)millis / 1000.f;
-		tbb::parallel_for(tbb::blocked_range<size_t>(0, models.size()), [&](const tbb::blocked_range<size_t>& r)
+		if (instancedModels)
+		{
+			instancedModels->animate("", seconds);
+			instancedModels->update(window.device, window.swapChain, window.cam);
+		}
+		vkl::JobSystem::instance().parallelFor(models.size(), 8, [&](size_t begin, size_t end)
 			{
-				for (size_t i = r.begin(); i != r.end(); ++i)
+				for (size_t i = begin; i != end; ++i)
 				{
 					models[i]->animate("", seconds);
 					models[i]->update(window.device, window.swapChain, window.cam);
 				}
 			});
 		axis->update(window.cam);
+		window.commandDispatcher.setCullFrustum(window.cam.cullFrustum());
+		if (occlusion)
+		{
+			glm::mat4 viewProjection = window.cam.projection() * window.cam.view();
+			occlusion->setViewProjection(glm::value_ptr(viewProjection));
+		}
 		updateWindow(window);
 	}
+	window.device.waitIdle();
+	if (instancedModels)
+		instancedModels->cleanUp(window.device);
+	if (occlusion)
+		occlusion->cleanUp(window.device);
 	window.cleanUp(instance);
 	instance.cleanUp();
 	vkl::Window::cleanUpWindowSystem();
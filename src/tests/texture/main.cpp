@@ -69,13 +69,15 @@ class ImagePlane : public vkl::RenderObject
 		description.declareVertexAttribute(0, 1, VK_FORMAT_R32G32_SFLOAT, sizeof(Vertex), offsetof(Vertex, uv));
 
 		description.declareTexture(1);
+		//set 0 is pushed with the draw instead of allocated where the device supports it
+		description.setPushDescriptors(true);
 	}
 
 public:
 	ImagePlane() = delete;
 	ImagePlane(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager)
 	{
-		auto vbo = bufferManager.createVertexBuffer(device, swapChain);
+		auto vbo = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
 
 		_verts.push_back({ glm::vec2(-0.5, -0.5), glm::vec2(0,0) });
 		_verts.push_back({ glm::vec2(-0.5, 0.5), glm::vec2(0,1) });
@@ -93,7 +95,7 @@ public:
 		_indices.push_back(3);
 		_indices.push_back(1);
 		_indices.push_back(2);
-		auto indexBuffer = bufferManager.createIndexBuffer(device, swapChain);
+		auto indexBuffer = bufferManager.createIndexBuffer(device, swapChain, vkl::BufferUsage::Static);
 		indexBuffer->setData(_indices);
 		drawCall->setCount(_indices.size());
 
@@ -69,7 +69,7 @@ class Triangle : public vkl::RenderObject
 public:
 	Triangle(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager)
 	{
-		auto vbo = bufferManager.createVertexBuffer(device, swapChain);
+		auto vbo = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
 
 		_verts.push_back({ glm::vec2(0.0, -0.5), glm::vec3(1,0,0) });
 		_verts.push_back({ glm::vec2(-0.5, 0.5), glm::vec3(0,1,0) });
@@ -84,7 +84,7 @@ public:
 		_indices.push_back(0);
 		_indices.push_back(1);
 		_indices.push_back(2);
-		auto indexBuffer = bufferManager.createIndexBuffer(device, swapChain);
+		auto indexBuffer = bufferManager.createIndexBuffer(device, swapChain, vkl::BufferUsage::Static);
 		indexBuffer->setData(_indices);
 		
 		drawCall->setIndexBuffer(indexBuffer);
@@ -0,0 +1,161 @@
+#include <vkl/BindlessTextures.h>
+
+#include <vkl/Device.h>
+#include <vkl/DeletionQueue.h>
+
+namespace vkl
+{
+	BindlessTextureTable::BindlessTextureTable(const Device& device)
+	{
+		if (!device.bindlessSupported())
+		{
+			throw std::runtime_error("Error");
+		}
+
+		_capacity = device.maxBindlessTextures();
+		_layout = createSetLayout(device);
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = _capacity;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = 1;
+
+		if (vkCreateDescriptorPool(device.handle(), &poolInfo, nullptr, &_pool) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = _pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &_layout;
+
+		if (vkAllocateDescriptorSets(device.handle(), &allocInfo, &_set) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+	}
+
+	VkDescriptorSetLayout BindlessTextureTable::createSetLayout(const Device& device)
+	{
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = device.maxBindlessTextures();
+		binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+		//slots that aren't used by a draw don't need to be valid, and can be written while the set is bound
+		VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		flagsInfo.bindingCount = 1;
+		flagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if (vkCreateDescriptorSetLayout(device.handle(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+		return layout;
+	}
+
+	uint32_t BindlessTextureTable::add(const Device& device, VkImageView view, VkSampler sampler)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		uint32_t index = NoBindlessIndex;
+		if (!_freeIndices.empty())
+		{
+			index = _freeIndices.back();
+			_freeIndices.pop_back();
+		}
+		else if (_nextIndex < _capacity)
+		{
+			index = _nextIndex++;
+		}
+		if (index == NoBindlessIndex)
+			return index;
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = view;
+		imageInfo.sampler = sampler;
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = _set;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = index;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device.handle(), 1, &descriptorWrite, 0, nullptr);
+
+		++_textureCount;
+		return index;
+	}
+
+	void BindlessTextureTable::remove(uint32_t index)
+	{
+		if (index == NoBindlessIndex)
+			return;
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_pendingIndices.emplace_back(_frameSerial, index);
+		--_textureCount;
+	}
+
+	void BindlessTextureTable::collect(size_t framesInFlight)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		++_frameSerial;
+		size_t ready = 0;
+		while (ready < _pendingIndices.size() && _pendingIndices[ready].first + framesInFlight <= _frameSerial)
+			_freeIndices.push_back(_pendingIndices[ready++].second);
+		_pendingIndices.erase(_pendingIndices.begin(), _pendingIndices.begin() + ready);
+	}
+
+	VkDescriptorSet BindlessTextureTable::setHandle() const
+	{
+		return _set;
+	}
+
+	VkDescriptorSetLayout BindlessTextureTable::layoutHandle() const
+	{
+		return _layout;
+	}
+
+	uint32_t BindlessTextureTable::textureCount() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _textureCount;
+	}
+
+	uint32_t BindlessTextureTable::capacity() const
+	{
+		return _capacity;
+	}
+
+	void BindlessTextureTable::cleanUp(const Device& device)
+	{
+		device.deletionQueue().destroyDescriptorPool(_pool);
+		vkDestroyDescriptorSetLayout(device.handle(), _layout, nullptr);
+		_pool = VK_NULL_HANDLE;
+		_layout = VK_NULL_HANDLE;
+		_set = VK_NULL_HANDLE;
+	}
+}
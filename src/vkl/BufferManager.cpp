@@ -11,66 +11,82 @@ namespace vkl
 {
 	BufferManager::BufferManager(const Device& device, const SwapChain& swapChain)
 	{
+		_uniformRing = std::make_shared<UniformRing>(device, swapChain);
 	}
 	
 	BufferManager::~BufferManager()
 	{
+		//buffers still held elsewhere must not queue themselves on a list that is gone
+		for (auto&& ib : _indexBuffers)
+			_dirtyList.detach(*ib);
+		for (auto&& vbo : _vertexBuffers)
+			_dirtyList.detach(*vbo);
+		for (auto&& ubo : _uniformBuffers)
+			_dirtyList.detach(*ubo);
 	}
 
 	void BufferManager::update(const Device& device, const SwapChain& swapChain)
 	{
-		for (auto itr = _indexBuffers.begin(); itr != _indexBuffers.end();)
-		{
-			(*itr)->update(device, swapChain);
-			++itr;
-		}
-		for (auto itr = _uniformBuffers.begin(); itr != _uniformBuffers.end();)
-		{
-			(*itr)->update(device, swapChain);
-			++itr;
-		}
-		for (auto itr = _vertexBuffers.begin(); itr != _vertexBuffers.end();)
-		{
-			(*itr)->update(device, swapChain);
-			++itr;
-		}
-		for (auto itr = _textureBuffers.begin(); itr != _textureBuffers.end();)
-		{
-			(*itr)->update(device, swapChain);
-			++itr;
-		}
+		if (_bindlessTextures)
+			_bindlessTextures->collect(swapChain.framesInFlight());
+
+		_dirtyList.flush(device, swapChain);
 	}
 
-	std::shared_ptr<IndexBuffer> BufferManager::createIndexBuffer(const Device& device, const SwapChain& swapChain)
+	size_t BufferManager::pendingUpdates() const
 	{
-		auto newOne = std::make_shared<IndexBuffer>(device, swapChain);
+		return _dirtyList.size();
+	}
+
+	std::shared_ptr<IndexBuffer> BufferManager::createIndexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage)
+	{
+		auto newOne = std::make_shared<IndexBuffer>(device, swapChain, usage);
+		_dirtyList.attach(*newOne);
 		_indexBuffers.emplace_back(newOne);
 		return newOne;
 	}
-	std::shared_ptr<VertexBuffer> BufferManager::createVertexBuffer(const Device& device, const SwapChain& swapChain)
+	std::shared_ptr<VertexBuffer> BufferManager::createVertexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage)
 	{
-		auto newOne = std::make_shared<VertexBuffer>(device, swapChain);
+		auto newOne = std::make_shared<VertexBuffer>(device, swapChain, usage);
+		_dirtyList.attach(*newOne);
 		_vertexBuffers.emplace_back(newOne);
 		return newOne;
 	}
 	std::shared_ptr<TextureBuffer> BufferManager::createTextureBuffer(const Device& device, const SwapChain& swapChain, const void* imageData, size_t width, size_t height, size_t components, const TextureOptions& options)
 	{
 		auto newOne = std::make_shared<TextureBuffer>(device, swapChain, imageData, width, height, components, options);
+		if (_bindlessTextures)
+			newOne->_bindlessIndex = _bindlessTextures->add(device, newOne->imageViewHandle(), newOne->samplerHandle());
 		_textureBuffers.emplace_back(newOne);
 		return newOne;
 	}
 	std::shared_ptr<UniformBuffer> BufferManager::createUniformBuffer(const Device& device, const SwapChain& swapChain)
 	{
-		auto newOne = std::make_shared<UniformBuffer>(device, swapChain);
+		auto newOne = std::make_shared<UniformBuffer>(device, swapChain, _uniformRing);
+		_dirtyList.attach(*newOne);
 		_uniformBuffers.emplace_back(newOne);
 		return newOne;
 	}
+	void BufferManager::enableBindlessTextures(const Device& device)
+	{
+		if (_bindlessTextures)
+			return;
+
+		_bindlessTextures = std::make_shared<BindlessTextureTable>(device);
+		for (auto&& tex : _textureBuffers)
+			tex->_bindlessIndex = _bindlessTextures->add(device, tex->imageViewHandle(), tex->samplerHandle());
+	}
+	std::shared_ptr<const BindlessTextureTable> BufferManager::bindlessTextures() const
+	{
+		return _bindlessTextures;
+	}
 	void BufferManager::cleanUnusedBuffers(const Device& device)
 	{
 		for (auto itr = _indexBuffers.begin(); itr != _indexBuffers.end();)
 		{
 			if (itr->use_count() == 1)
 			{
+				_dirtyList.detach(**itr);
 				(*itr)->cleanUp(device);
 				itr = _indexBuffers.erase(itr);
 			}
@@ -83,6 +99,7 @@ namespace vkl
 		{
 			if (itr->use_count() == 1)
 			{
+				_dirtyList.detach(**itr);
 				(*itr)->cleanUp(device);
 				itr = _uniformBuffers.erase(itr);
 			}
@@ -95,6 +112,7 @@ namespace vkl
 		{
 			if (itr->use_count() == 1)
 			{
+				_dirtyList.detach(**itr);
 				(*itr)->cleanUp(device);
 				itr = _vertexBuffers.erase(itr);
 			}
@@ -107,6 +125,8 @@ namespace vkl
 		{
 			if (itr->use_count() == 1)
 			{
+				if (_bindlessTextures)
+					_bindlessTextures->remove((*itr)->bindlessIndex());
 				(*itr)->cleanUp(device);
 				itr = _textureBuffers.erase(itr);
 			}
@@ -119,11 +139,20 @@ namespace vkl
 	void BufferManager::cleanUp(const Device& device)
 	{
 		for (auto&& ib : _indexBuffers)
+		{
+			_dirtyList.detach(*ib);
 			ib->cleanUp(device);
+		}
 		for (auto&& vbo : _vertexBuffers)
+		{
+			_dirtyList.detach(*vbo);
 			vbo->cleanUp(device);
+		}
 		for (auto&& ubo : _uniformBuffers)
+		{
+			_dirtyList.detach(*ubo);
 			ubo->cleanUp(device);
+		}
 		for (auto&& tex : _textureBuffers)
 			tex->cleanUp(device);
 
@@ -131,5 +160,12 @@ namespace vkl
 		_vertexBuffers.clear();
 		_uniformBuffers.clear();
 		_textureBuffers.clear();
+
+		if (_uniformRing)
+			_uniformRing->cleanUp(device);
+
+		if (_bindlessTextures)
+			_bindlessTextures->cleanUp(device);
+		_bindlessTextures = nullptr;
 	}
 }
\ No newline at end of file
@@ -5,53 +5,253 @@
 #include <vkl/RenderObject.h>
 #include <vkl/RenderPass.h>
 
-#include <future>
+#include <vkl/JobSystem.h>
+#include <vkl/GpuCulling.h>
+#include <vkl/OcclusionCulling.h>
+
 #include <iostream>
+#include <algorithm>
 #include <array>
-
-#define MULTITHREADED
+#include <chrono>
+#include <mutex>
 
 namespace vkl
 {
-	class CommandThread
+	namespace
 	{
-	public:
+		//finer than one chunk per thread so fast threads can steal from slow ones
+		constexpr size_t ChunksPerThread = 4;
+		constexpr uint32_t NoOcclusionTest = UINT32_MAX;
+		//guess for objects that have never been recorded
+		constexpr float BaseRecordCost = 2000.f;
+		constexpr float DrawCallRecordCost = 1000.f;
+
+		float estimatedRecordCost(const RenderObject* object)
+		{
+			float cost = object->recordCost();
+			if (cost > 0.f)
+				return cost;
+			return BaseRecordCost + DrawCallRecordCost * (float)object->drawCallCount();
+		}
 
+		//lsd radix sort on the 64 bit key, 8 bits a pass, passes where every key shares the digit are skipped
+		template <typename T>
+		void radixSortByKey(std::vector<T>& items, std::vector<T>& scratch)
+		{
+			size_t count = items.size();
+			if (count < 2)
+				return;
+			scratch.resize(count);
+
+			std::array<std::array<uint32_t, 256>, 8> histograms{};
+			for (auto&& item : items)
+			{
+				for (size_t pass = 0; pass < 8; ++pass)
+					++histograms[pass][(item.key >> (pass * 8)) & 0xFF];
+			}
 
-		CommandThread(const Device& device, const SwapChain& swapChain)
+			T* src = items.data();
+			T* dst = scratch.data();
+			for (size_t pass = 0; pass < 8; ++pass)
+			{
+				auto& histogram = histograms[pass];
+				size_t shift = pass * 8;
+				if (histogram[(src[0].key >> shift) & 0xFF] == count)
+					continue;
+
+				uint32_t offset = 0;
+				for (auto&& bucket : histogram)
+				{
+					uint32_t bucketCount = bucket;
+					bucket = offset;
+					offset += bucketCount;
+				}
+				for (size_t i = 0; i < count; ++i)
+					dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+				std::swap(src, dst);
+			}
+
+			if (src != items.data())
+				items.swap(scratch);
+		}
+	}
+
+	//one per job system thread: a transient pool that hands out as many secondaries a frame as the thread needs,
+	//plus a pool for the cached buffers of static objects
+	class CommandRecorder
+	{
+	public:
+		CommandRecorder(const Device& device, const SwapChain& swapChain)
 		{
 			VkCommandPoolCreateInfo poolInfo{};
 			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 			poolInfo.queueFamilyIndex = swapChain.graphicsFamilyQueueIndex();
-			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			//one pool per frame in flight, reset in one go once that frame is done on the gpu
+			_commandPools.resize(swapChain.framesInFlight());
+			for (auto&& pool : _commandPools)
+			{
+				if (vkCreateCommandPool(device.handle(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+					throw std::runtime_error("Error");
+				}
+			}
 
-			if (vkCreateCommandPool(device.handle(), &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+			//cached buffers live for many frames and are re-recorded one at a time, keep them out of the transient pools
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+			if (vkCreateCommandPool(device.handle(), &poolInfo, nullptr, &_staticPool) != VK_SUCCESS) {
 				throw std::runtime_error("Error");
 			}
 
 			_commandBuffers.resize(swapChain.framesInFlight());
+			_usedBuffers.resize(swapChain.framesInFlight());
+		}
+		CommandRecorder() = delete;
+		~CommandRecorder() = default;
+		CommandRecorder(const CommandRecorder&) = delete;
+		CommandRecorder(CommandRecorder&&) noexcept = delete;
+		CommandRecorder& operator=(CommandRecorder&&) noexcept = delete;
+		CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+		//only once the frame's fence has signaled (SwapChain::prepNextFrame)
+		void beginFrame(const Device& device, size_t frame)
+		{
+			if (_usedBuffers[frame] > 0)
+				vkResetCommandPool(device.handle(), _commandPools[frame], 0);
+			_usedBuffers[frame] = 0;
+			_stats = {};
+		}
+
+		//packets run parallel to objects, draws is the array their draw ranges point into
+		VkCommandBuffer processObjectsNow(std::span<RenderObject* const> objects, const DrawPacket* packets, const PacketDraw* draws, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+		{
+			//only ever contended by threads sharing the job system's overflow slot
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			VkCommandBuffer buffer = nextBuffer(device, swapChain.frame());
+			beginSecondary(buffer, pass, frameBuffer, extent);
+
+			CommandStateTracker state;
+			uint64_t nanos = 0;
+			for (size_t i = 0; i < objects.size(); ++i)
+				nanos += recordTimed(objects[i], &packets[i], draws, state, buffer, pipelines, swapChain, extent);
+
+			if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+
+			_stats.recordNanos += nanos;
+			_stats.objects += (uint32_t)objects.size();
+			++_stats.chunks;
+			_stats.bindsIssued += state.issued();
+			_stats.bindsSkipped += state.skipped();
+
+			return buffer;
+		}
+
+		uint64_t recordStatic(VkCommandBuffer buffer, RenderObject* object, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+		{
+			beginSecondary(buffer, pass, frameBuffer, extent);
+
+			CommandStateTracker state;
+			uint64_t nanos = recordTimed(object, nullptr, nullptr, state, buffer, pipelines, swapChain, extent);
+
+			if (vkEndCommandBuffer(buffer) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			return nanos;
+		}
+
+		void addStats(uint64_t nanos, uint32_t objects)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_stats.recordNanos += nanos;
+			_stats.objects += objects;
+			++_stats.chunks;
+		}
+
+		DispatchThreadStats stats() const
+		{
+			return _stats;
+		}
+
+		std::vector<VkCommandBuffer> allocateStatic(const Device& device, size_t count)
+		{
+			std::vector<VkCommandBuffer> buffers(count);
 
 			VkCommandBufferAllocateInfo allocInfo{};
 			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-			allocInfo.commandPool = _commandPool;
+			allocInfo.commandPool = _staticPool;
 			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-			allocInfo.commandBufferCount = (uint32_t)_commandBuffers.size();
+			allocInfo.commandBufferCount = (uint32_t)buffers.size();
 
-			if (vkAllocateCommandBuffers(device.handle(), &allocInfo, _commandBuffers.data()) != VK_SUCCESS) {
+			if (vkAllocateCommandBuffers(device.handle(), &allocInfo, buffers.data()) != VK_SUCCESS) {
 				throw std::runtime_error("Error");
 			}
+			return buffers;
+		}
+
+		void freeStatic(const Device& device, std::span<const VkCommandBuffer> buffers)
+		{
+			if (!buffers.empty())
+				vkFreeCommandBuffers(device.handle(), _staticPool, (uint32_t)buffers.size(), buffers.data());
+		}
 
-			_running = true;
-			_thread = std::make_unique<std::thread>([this] {run(); });
+		void cleanUp(const Device& device)
+		{
+			for (size_t frame = 0; frame < _commandPools.size(); ++frame)
+			{
+				if (!_commandBuffers[frame].empty())
+					vkFreeCommandBuffers(device.handle(), _commandPools[frame], (uint32_t)_commandBuffers[frame].size(), _commandBuffers[frame].data());
+				vkDestroyCommandPool(device.handle(), _commandPools[frame], nullptr);
+			}
+			_commandBuffers.clear();
+			_commandPools.clear();
+			vkDestroyCommandPool(device.handle(), _staticPool, nullptr);
+		}
+	private:
+		VkCommandBuffer nextBuffer(const Device& device, size_t frame)
+		{
+			auto& buffers = _commandBuffers[frame];
+			if (_usedBuffers[frame] == buffers.size())
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.commandPool = _commandPools[frame];
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocInfo.commandBufferCount = 1;
+
+				VkCommandBuffer buffer = VK_NULL_HANDLE;
+				if (vkAllocateCommandBuffers(device.handle(), &allocInfo, &buffer) != VK_SUCCESS) {
+					throw std::runtime_error("Error");
+				}
+				buffers.push_back(buffer);
+			}
+			return buffers[_usedBuffers[frame]++];
 		}
-		CommandThread() = delete;
-		~CommandThread() = default;
-		CommandThread(const CommandThread&) = delete;
-		CommandThread(CommandThread&&) noexcept = default;
-		CommandThread& operator=(CommandThread&&) noexcept = default;
-		CommandThread& operator=(const CommandThread&) = delete;
 
-		VkCommandBuffer processObjectsNow(std::span<const std::shared_ptr<RenderObject>> objects, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+		uint64_t recordTimed(RenderObject* object, const DrawPacket* packet, const PacketDraw* draws, CommandStateTracker& state, VkCommandBuffer buffer, const PipelineManager& pipelines, const SwapChain& swapChain, const VkExtent2D& extent)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (packet && packet->pipeline)
+			{
+				state.record(buffer, *packet, draws, extent);
+			}
+			else
+			{
+				//no idea what it binds, start over after it
+				object->recordCommands(swapChain, pipelines, buffer, extent);
+				state.reset();
+			}
+			uint64_t nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+			//smoothed so one hitch doesn't throw the next frame's balance off
+			float previous = object->recordCost();
+			object->setRecordCost(previous == 0.f ? (float)nanos : previous * 0.8f + (float)nanos * 0.2f);
+			return nanos;
+		}
+
+		void beginSecondary(VkCommandBuffer buffer, const RenderPass& pass, VkFramebuffer frameBuffer, const VkExtent2D& extent)
 		{
 			VkCommandBufferInheritanceInfo inherit{};
 			inherit.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
@@ -64,7 +264,7 @@ namespace vkl
 			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
 			beginInfo.pInheritanceInfo = &inherit;
 
-			if (vkBeginCommandBuffer(_commandBuffers[swapChain.frame()], &beginInfo) != VK_SUCCESS) {
+			if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS) {
 				throw std::runtime_error("Error");
 			}
 
@@ -73,170 +273,325 @@ namespace vkl
 			viewport.width = (float)extent.width;
 			viewport.minDepth = 0.0;
 			viewport.maxDepth = 1.0;
-			vkCmdSetViewport(_commandBuffers[swapChain.frame()], 0, 1, &viewport);
+			vkCmdSetViewport(buffer, 0, 1, &viewport);
+		}
 
+		std::vector<VkCommandPool> _commandPools;
+		VkCommandPool _staticPool{ VK_NULL_HANDLE };
+		std::vector<std::vector<VkCommandBuffer>> _commandBuffers;
+		std::vector<size_t> _usedBuffers;
 
-			for (auto&& object : objects)
-			{
-				object->recordCommands(swapChain, pipelines, _commandBuffers[swapChain.frame()], extent);
-			}
+		std::mutex _mutex;
+		DispatchThreadStats _stats;
+	};
 
-			if (vkEndCommandBuffer(_commandBuffers[swapChain.frame()]) != VK_SUCCESS) {
+
+	CommandDispatcher::CommandDispatcher(const Device& device, const SwapChain& swapChain)
+	{
+		//one recorder per job system thread, the job system is shared by every dispatcher
+		size_t recorderCount = JobSystem::instance().threadSlots();
+		for (size_t i = 0; i < recorderCount; ++i)
+		{
+			_recorders.emplace_back(std::move(std::make_unique<CommandRecorder>(device, swapChain)));
+		}
+		_threadStats.resize(recorderCount);
+		_staticRecords.resize(JobSystem::instance().maxConcurrency());
+
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = swapChain.graphicsFamilyQueueIndex();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		_commandPools.resize(swapChain.framesInFlight());
+		_primaryBuffers.resize(swapChain.framesInFlight());
+		for (size_t frame = 0; frame < _commandPools.size(); ++frame)
+		{
+			if (vkCreateCommandPool(device.handle(), &poolInfo, nullptr, &_commandPools[frame]) != VK_SUCCESS) {
 				throw std::runtime_error("Error");
 			}
 
-			return _commandBuffers[swapChain.frame()];
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = _commandPools[frame];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device.handle(), &allocInfo, &_primaryBuffers[frame]) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
 		}
 
-		std::future<VkCommandBuffer> processObjects(std::span<const std::shared_ptr<RenderObject>> objects, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+	}
+
+	CommandDispatcher::CommandDispatcher(CommandDispatcher&&) noexcept = default;
+	CommandDispatcher& CommandDispatcher::operator=(CommandDispatcher&&) noexcept = default;
+
+	CommandDispatcher::~CommandDispatcher()
+	{
+	}
+	void CommandDispatcher::processUnsortedObjects(std::span< std::shared_ptr<RenderObject>> objects, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+	{
+		cullObjects(objects);
+		splitOccluded(swapChain, pass);
+		for (auto&& ro : _visibleList)
+			ro->updateDescriptors(device, swapChain, pipelines);
+		for (auto&& ro : _occludedList)
+			ro->updateDescriptors(device, swapChain, pipelines);
+
+		//opaque then alpha tested in the order given, blended back to front after both
+		_drawList.clear();
+		for (RenderQueue queue : { RenderQueue::Opaque, RenderQueue::Mask })
 		{
-			std::future<VkCommandBuffer> future;
-			auto promise = std::make_shared<std::promise<VkCommandBuffer>>();
-			future = promise->get_future();
+			for (auto&& ro : _visibleList)
 			{
-				std::unique_lock<std::mutex> lock(_mutex);
-				_tasks.emplace_back([objects, &pipelines, &pass, &swapChain, frameBuffer, &extent, promise, this]() {
-					promise->set_value(processObjectsNow(objects, pipelines, pass, swapChain, frameBuffer, extent));
-					});
+				if (ro->renderQueue() == queue)
+					_drawList.push_back(ro);
 			}
-			_condition.notify_all();
-			return future;
 		}
 
-		VkCommandBuffer handle(size_t frame) const
+		_sortItems.clear();
+		for (size_t i = 0; i < _visibleList.size(); ++i)
 		{
-			return _commandBuffers[frame];
+			if (_visibleList[i]->renderQueue() == RenderQueue::Blend)
+				_sortItems.push_back({ _visibleList[i]->sortKey(pipelines), (uint32_t)i });
 		}
-		void cleanUp(const Device& device)
-		{
-			{
-				std::unique_lock<std::mutex> lock(_mutex);
-				_running = false;
-			}
 
-			_condition.notify_all();
+		radixSortByKey(_sortItems, _sortScratch);
 
-			_thread->join();
-			_thread = nullptr;
+		for (auto&& item : _sortItems)
+			_drawList.push_back(_visibleList[item.index]);
 
-			vkFreeCommandBuffers(device.handle(), _commandPool, (uint32_t)_commandBuffers.size(), _commandBuffers.data());
-			vkDestroyCommandPool(device.handle(), _commandPool, nullptr);
-		}
-	private:
+		recordDrawList(device, pipelines, pass, swapChain, frameBuffer, extent);
+	}
+	void CommandDispatcher::processSortedObjects(std::span< std::shared_ptr<RenderObject>> objects, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+	{
+		cullObjects(objects);
+		splitOccluded(swapChain, pass);
+		for (auto&& ro : _visibleList)
+			ro->updateDescriptors(device, swapChain, pipelines);
+		for (auto&& ro : _occludedList)
+			ro->updateDescriptors(device, swapChain, pipelines);
+
+		_sortItems.clear();
+		for (size_t i = 0; i < _visibleList.size(); ++i)
+			_sortItems.push_back({ _visibleList[i]->sortKey(pipelines), (uint32_t)i });
+
+		radixSortByKey(_sortItems, _sortScratch);
+
+		_drawList.clear();
+		for (auto&& item : _sortItems)
+			_drawList.push_back(_visibleList[item.index]);
 
-		void run()
+		recordDrawList(device, pipelines, pass, swapChain, frameBuffer, extent);
+	}
+	void CommandDispatcher::recordDrawList(const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+	{
+		++_frameSerial;
+		size_t frame = swapChain.frame();
+
+		//before anything looks at packets or signatures, a culler can get new buffers here
+		for (auto&& culler : _cullers)
+			culler->update(device, swapChain);
+		if (_occlusionActive)
+			_occlusionCuller->update(device, swapChain);
+
+		//with a second phase, blended objects move behind it so they still go over everything opaque
+		_lateDraws.clear();
+		_latePackets.clear();
+		_latePacketDraws.clear();
+		bool resume = _occlusionActive && !_occludedList.empty();
+		if (resume)
 		{
-			while (true)
+			for (size_t i = 0; i < _occludedList.size(); ++i)
 			{
-				std::vector < std::function<void()>> localTasks;
-				bool quit = false;
-				{
-					std::unique_lock<std::mutex> lock(_mutex);
-					_condition.wait(lock, [this]() {
-						return !_tasks.empty() || !_running;
-						});
-					localTasks = std::move(_tasks);
-					_tasks.clear();
-					quit = !_running;
-				}
-				//should we finish tasks before bailing?
-				for (auto&& task : localTasks)
+				//no pre-pass in the second phase, each object lays down its own depth right before it shades
+				RenderObject* object = _occludedList[i];
+				if (pass.options().depthPrePass && object->appendDepthPacket(swapChain, pipelines, _latePackets, _latePacketDraws))
+					_lateDraws.push_back({ object, _occludedTests[i] });
+				if (!object->appendDrawPacket(swapChain, pipelines, _latePackets, _latePacketDraws))
+					_latePackets.emplace_back();
+				_lateDraws.push_back({ object, _occludedTests[i] });
+			}
+
+			size_t kept = 0;
+			for (auto&& object : _drawList)
+			{
+				if (object->renderQueue() != RenderQueue::Blend)
 				{
-					task();
+					_drawList[kept++] = object;
+					continue;
 				}
-				if (quit)
-					break;
+				if (!object->appendDrawPacket(swapChain, pipelines, _latePackets, _latePacketDraws))
+					_latePackets.emplace_back();
+				_lateDraws.push_back({ object, NoOcclusionTest });
 			}
+			_drawList.resize(kept);
 		}
-		VkCommandPool _commandPool{ VK_NULL_HANDLE };
-		std::vector<VkCommandBuffer> _commandBuffers;
 
-		std::unique_ptr<std::thread> _thread;
-		bool _running = false;
-		std::mutex _mutex;
-		std::condition_variable _condition;
-		std::vector < std::function<void()>> _tasks;
+		//static objects replay their cached buffers, only the ones whose signature changed get re-recorded
+		_dynamicList.clear();
+		_dynamicBreaks.clear();
+		_staticBuffers.clear();
+		for (auto&& records : _staticRecords)
+			records.clear();
+		for (auto&& object : _drawList)
+		{
+			if (!object->isStatic())
+			{
+				_dynamicList.push_back(object);
+				continue;
+			}
 
-	};
+			//the dynamic objects around it go in different chunks so the cached buffer can be executed between them
+			if (!_dynamicList.empty() && (_dynamicBreaks.empty() || _dynamicBreaks.back() != _dynamicList.size()))
+				_dynamicBreaks.push_back(_dynamicList.size());
 
+			auto& cached = _staticCache[object];
+			if (cached.objectId != object->objectId())
+			{
+				//new object, or a new one living at a dead one's address
+				if (!cached.buffers.empty())
+					_recorders[cached.owner]->freeStatic(device, cached.buffers);
+				cached.objectId = object->objectId();
+				cached.owner = _nextStaticOwner++ % _staticRecords.size();
+				cached.buffers = _recorders[cached.owner]->allocateStatic(device, swapChain.framesInFlight());
+				cached.signatures.assign(swapChain.framesInFlight(), 0);
+			}
+			cached.lastUsed = _frameSerial;
 
-	CommandDispatcher::CommandDispatcher(const Device& device, const SwapChain& swapChain)
-	{
-#ifdef MULTITHREADED
-		unsigned int threadCount = std::thread::hardware_concurrency();
-#else
-		unsigned int threadCount = 1;
-#endif
-		for (unsigned int i = 0; i < threadCount; ++i)
-		{
-			_threads.emplace_back(std::move(std::make_unique<CommandThread>(device, swapChain)));
+			uint64_t signature = object->commandSignature(swapChain, pipelines, frameBuffer, extent);
+			if (cached.signatures[frame] != signature)
+			{
+				cached.signatures[frame] = signature;
+				_staticRecords[cached.owner].emplace_back(object, &cached);
+			}
+			_staticBuffers.push_back(cached.buffers[frame]);
 		}
 
+		//anything not drawn for a full swap chain cycle can't be in flight anymore
+		for (auto itr = _staticCache.begin(); itr != _staticCache.end();)
+		{
+			if (_frameSerial - itr->second.lastUsed > swapChain.framesInFlight())
+			{
+				_recorders[itr->second.owner]->freeStatic(device, itr->second.buffers);
+				itr = _staticCache.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
 
-		VkCommandPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		poolInfo.queueFamilyIndex = swapChain.graphicsFamilyQueueIndex();
-		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		_staticOwners.clear();
+		for (size_t owner = 0; owner < _staticRecords.size(); ++owner)
+		{
+			if (!_staticRecords[owner].empty())
+				_staticOwners.push_back(owner);
+		}
 
-		if (vkCreateCommandPool(device.handle(), &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
-			throw std::runtime_error("Error");
+		//compiled on this thread so the recording threads only read flat pod arrays
+		_packets.clear();
+		_packetDraws.clear();
+		for (auto&& object : _dynamicList)
+		{
+			if (!object->appendDrawPacket(swapChain, pipelines, _packets, _packetDraws))
+				_packets.emplace_back();
 		}
-		_primaryBuffers.resize(swapChain.framesInFlight());
 
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = _commandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = (uint32_t)_primaryBuffers.size();
+		//every object with a depth only pipeline, front to back whatever order the main pass is in
+		_depthList.clear();
+		_depthPackets.clear();
+		_depthDraws.clear();
+		if (pass.options().depthPrePass)
+		{
+			_sortItems.clear();
+			for (size_t i = 0; i < _drawList.size(); ++i)
+				_sortItems.push_back({ _drawList[i]->depthSortKey(), (uint32_t)i });
 
-		if (vkAllocateCommandBuffers(device.handle(), &allocInfo, _primaryBuffers.data()) != VK_SUCCESS) {
-			throw std::runtime_error("Error");
+			radixSortByKey(_sortItems, _sortScratch);
+
+			for (auto&& item : _sortItems)
+			{
+				RenderObject* object = _drawList[item.index];
+				if (object->appendDepthPacket(swapChain, pipelines, _depthPackets, _depthDraws))
+					_depthList.push_back(object);
+			}
 		}
 
-	}
+		for (auto&& recorder : _recorders)
+			recorder->beginFrame(device, frame);
 
-	CommandDispatcher::CommandDispatcher(CommandDispatcher&&) noexcept = default;
-	CommandDispatcher& CommandDispatcher::operator=(CommandDispatcher&&) noexcept = default;
+		buildChunks(_dynamicList, _chunks, _dynamicBreaks);
+		buildChunks(_depthList, _depthChunks);
+		_secondaryBuffers.resize(_chunks.size());
+		_depthBuffers.resize(_depthChunks.size());
 
-	CommandDispatcher::~CommandDispatcher()
-	{
-	}
-	void CommandDispatcher::processUnsortedObjects(std::span< std::shared_ptr<RenderObject>> objects, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
-	{
-		for (auto&& ro : objects)
-			ro->updateDescriptors(device, swapChain, pipelines);
+		//static owners first (each touches only its own static pool), then the dynamic and depth chunks on whichever thread picks them up
+		size_t staticJobs = _staticOwners.size();
+		size_t dynamicJobs = _chunks.size();
+		JobSystem& jobs = JobSystem::instance();
+		jobs.parallelFor(staticJobs + dynamicJobs + _depthChunks.size(), 1, [&](size_t begin, size_t end)
+			{
+				CommandRecorder& threadRecorder = *_recorders[jobs.threadIndex()];
+				for (size_t item = begin; item < end; ++item)
+				{
+					if (item < staticJobs)
+					{
+						size_t owner = _staticOwners[item];
+						uint64_t nanos = 0;
+						for (auto&& [object, cached] : _staticRecords[owner])
+							nanos += _recorders[owner]->recordStatic(cached->buffers[frame], object, pipelines, pass, swapChain, frameBuffer, extent);
+						threadRecorder.addStats(nanos, (uint32_t)_staticRecords[owner].size());
+					}
+					else if (item < staticJobs + dynamicJobs)
+					{
+						const RecordChunk& chunk = _chunks[item - staticJobs];
+						std::span<RenderObject* const> objects(_dynamicList.data() + chunk.begin, chunk.end - chunk.begin);
+						_secondaryBuffers[item - staticJobs] = threadRecorder.processObjectsNow(objects, _packets.data() + chunk.begin, _packetDraws.data(), device, pipelines, pass, swapChain, frameBuffer, extent);
+					}
+					else
+					{
+						const RecordChunk& chunk = _depthChunks[item - staticJobs - dynamicJobs];
+						std::span<RenderObject* const> objects(_depthList.data() + chunk.begin, chunk.end - chunk.begin);
+						_depthBuffers[item - staticJobs - dynamicJobs] = threadRecorder.processObjectsNow(objects, _depthPackets.data() + chunk.begin, _depthDraws.data(), device, pipelines, pass, swapChain, frameBuffer, extent);
+					}
+				}
+			});
+
+		for (size_t i = 0; i < _recorders.size(); ++i)
+			_threadStats[i] = _recorders[i]->stats();
+
+		//cached and freshly recorded buffers back in sort order, a chunk goes where its first object sits
+		_mainBuffers.clear();
+		size_t staticIndex = 0;
+		size_t dynamicIndex = 0;
+		size_t chunkIndex = 0;
+		for (auto&& object : _drawList)
+		{
+			if (object->isStatic())
+			{
+				_mainBuffers.push_back(_staticBuffers[staticIndex++]);
+				continue;
+			}
+			if (chunkIndex < _chunks.size() && _chunks[chunkIndex].begin == dynamicIndex)
+				_mainBuffers.push_back(_secondaryBuffers[chunkIndex++]);
+			++dynamicIndex;
+		}
 
-#ifdef MULTITHREADED
-		//record commands
-		size_t objectCount = objects.size();
-		size_t objectsPerThread = objectCount / _threads.size() + 1;
-
-		size_t offset = 0;
-		size_t threadIndex = 0;
-		std::vector<VkCommandBuffer> buffers;
-		std::vector<std::future<VkCommandBuffer>> futures;
-		while (offset < objects.size())
-		{
-			auto objsToDo = std::min(objectsPerThread, objects.size() - offset);
-			futures.emplace_back(_threads[threadIndex]->processObjects(objects.subspan(offset, objsToDo), pipelines, pass, swapChain, frameBuffer, extent));
-			offset += objsToDo;
-			++threadIndex;
-		}
-		for (auto&& future : futures)
-			buffers.push_back(future.get());
-#else
-		VkCommandBuffer buffer = VK_NULL_HANDLE;
-		buffer = _threads[0]->processObjectsNow(objects, pipelines, pass, swapChain, frameBuffer, extent);
-#endif
+		vkResetCommandPool(device.handle(), _commandPools[frame], 0);
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		if (vkBeginCommandBuffer(_primaryBuffers[swapChain.frame()], &beginInfo) != VK_SUCCESS) {
 			throw std::runtime_error("Error");
 		}
 
+		for (auto&& culler : _cullers)
+			culler->recordCull(_primaryBuffers[swapChain.frame()], frame);
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassInfo.renderPass = pass.handle();
@@ -253,28 +608,264 @@ namespace vkl
 
 		vkCmdBeginRenderPass(_primaryBuffers[swapChain.frame()], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-#ifdef MULTITHREADED
-		vkCmdExecuteCommands(_primaryBuffers[swapChain.frame()], (uint32_t)buffers.size(), buffers.data());
-#else
-		vkCmdExecuteCommands(_primaryBuffers[swapChain.frame()], 1, &buffer);
-#endif
+		//depth pre-pass, then every object in sort order
+		if (!_depthBuffers.empty())
+			vkCmdExecuteCommands(_primaryBuffers[swapChain.frame()], (uint32_t)_depthBuffers.size(), _depthBuffers.data());
+		if (!_mainBuffers.empty())
+			vkCmdExecuteCommands(_primaryBuffers[swapChain.frame()], (uint32_t)_mainBuffers.size(), _mainBuffers.data());
 
 		vkCmdEndRenderPass(_primaryBuffers[swapChain.frame()]);
 
+		if (_occlusionActive)
+		{
+			_occlusionCuller->recordBuild(_primaryBuffers[swapChain.frame()], frame);
+			if (resume)
+				recordLate(_primaryBuffers[swapChain.frame()], device, pipelines, pass, swapChain, frameBuffer, extent);
+		}
+
 		if (vkEndCommandBuffer(_primaryBuffers[swapChain.frame()]) != VK_SUCCESS) {
 			throw std::runtime_error("Error");
 		}
 
 	}
+	void CommandDispatcher::recordLate(VkCommandBuffer buffer, const Device& device, const PipelineManager& pipelines, const RenderPass& pass, const SwapChain& swapChain, VkFramebuffer frameBuffer, const VkExtent2D& extent)
+	{
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = pass.resumeHandle();
+		renderPassInfo.framebuffer = frameBuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = extent;
+
+		vkCmdBeginRenderPass(buffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport{};
+		viewport.height = (float)extent.height;
+		viewport.width = (float)extent.width;
+		viewport.minDepth = 0.0;
+		viewport.maxDepth = 1.0;
+		vkCmdSetViewport(buffer, 0, 1, &viewport);
+
+		//binds aren't predicated, only the draws, so the tracker stays right across skipped objects
+		CommandStateTracker state;
+		for (size_t i = 0; i < _lateDraws.size(); ++i)
+		{
+			const LateDraw& late = _lateDraws[i];
+			if (late.test != NoOcclusionTest)
+			{
+				VkConditionalRenderingBeginInfoEXT conditionalInfo{};
+				conditionalInfo.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+				conditionalInfo.buffer = _occlusionCuller->predicateBuffer(swapChain.frame());
+				conditionalInfo.offset = (VkDeviceSize)late.test * OcclusionCuller::PredicateStride;
+				device.cmdBeginConditionalRendering()(buffer, &conditionalInfo);
+			}
+
+			if (_latePackets[i].pipeline)
+			{
+				state.record(buffer, _latePackets[i], _latePacketDraws.data(), extent);
+			}
+			else
+			{
+				late.object->recordCommands(swapChain, pipelines, buffer, extent);
+				state.reset();
+			}
+
+			if (late.test != NoOcclusionTest)
+				device.cmdEndConditionalRendering()(buffer);
+		}
+
+		vkCmdEndRenderPass(buffer);
+	}
+	void CommandDispatcher::buildChunks(std::span<RenderObject* const> list, std::vector<RecordChunk>& chunks, std::span<const size_t> breaks)
+	{
+		//contiguous runs keep the sorted order intact
+		chunks.clear();
+		if (list.empty())
+			return;
+
+		float totalCost = 0.f;
+		for (auto&& object : list)
+			totalCost += estimatedRecordCost(object);
+
+		size_t targetChunks = std::min(list.size(), JobSystem::instance().maxConcurrency() * ChunksPerThread);
+		float targetCost = totalCost / (float)targetChunks;
+
+		RecordChunk chunk{ 0, 0 };
+		float chunkCost = 0.f;
+		size_t nextBreak = 0;
+		for (size_t i = 0; i < list.size(); ++i)
+		{
+			if (nextBreak < breaks.size() && breaks[nextBreak] == i)
+			{
+				++nextBreak;
+				if (chunk.begin < i)
+				{
+					chunk.end = i;
+					chunks.push_back(chunk);
+					chunk.begin = i;
+					chunkCost = 0.f;
+				}
+			}
+			chunkCost += estimatedRecordCost(list[i]);
+			if (chunkCost >= targetCost)
+			{
+				chunk.end = i + 1;
+				chunks.push_back(chunk);
+				chunk.begin = i + 1;
+				chunkCost = 0.f;
+			}
+		}
+		if (chunk.begin < list.size())
+		{
+			chunk.end = list.size();
+			chunks.push_back(chunk);
+		}
+	}
+	void CommandDispatcher::cullObjects(std::span<std::shared_ptr<RenderObject>> objects)
+	{
+		_visibleList.clear();
+		_cullStats = {};
+		if (!_frustumCulling)
+		{
+			for (auto&& ro : objects)
+				_visibleList.push_back(ro.get());
+			return;
+		}
+
+		_cullX.clear();
+		_cullY.clear();
+		_cullZ.clear();
+		_cullRadius.clear();
+		for (auto&& ro : objects)
+		{
+			if (!ro->hasBoundingSphere())
+				continue;
+			const auto& sphere = ro->boundingSphere();
+			_cullX.push_back(sphere[0]);
+			_cullY.push_back(sphere[1]);
+			_cullZ.push_back(sphere[2]);
+			_cullRadius.push_back(sphere[3]);
+		}
+
+		_cullVisible.resize(_cullX.size());
+		CullSpheres spheres{ _cullX.data(), _cullY.data(), _cullZ.data(), _cullRadius.data(), _cullX.size() };
+		_cullStats.tested = (uint32_t)spheres.count;
+		_cullStats.visible = (uint32_t)cullSpheres(_frustum, spheres, _cullVisible.data());
+
+		size_t sphere = 0;
+		for (auto&& ro : objects)
+		{
+			if (!ro->hasBoundingSphere() || _cullVisible[sphere++])
+				_visibleList.push_back(ro.get());
+		}
+	}
+	void CommandDispatcher::splitOccluded(const SwapChain& swapChain, const RenderPass& pass)
+	{
+		_occludedList.clear();
+		_occludedTests.clear();
+		_occlusionSpheres.clear();
+		_occlusionActive = _occlusionCuller && pass.resumeHandle() != VK_NULL_HANDLE;
+		if (!_occlusionActive)
+			return;
+
+		size_t frame = swapChain.frame();
+		_occlusionIds.resize(swapChain.framesInFlight());
+
+		//this frame's last submit is done, whatever it found is the newest there is
+		auto& ids = _occlusionIds[frame];
+		std::span<const uint32_t> results = _occlusionCuller->results(frame);
+		for (size_t i = 0; i < ids.size() && i < results.size(); ++i)
+		{
+			auto itr = _occlusionStates.find(ids[i]);
+			if (itr != _occlusionStates.end())
+				itr->second.occluded = results[i] == 0;
+		}
+		ids.clear();
+
+		//first phase keeps anything not known to be hidden, new objects included
+		size_t kept = 0;
+		for (auto&& ro : _visibleList)
+		{
+			//blended objects don't write depth and are always drawn
+			if (!ro->hasBoundingSphere() || ro->renderQueue() == RenderQueue::Blend)
+			{
+				_visibleList[kept++] = ro;
+				continue;
+			}
+
+			auto& state = _occlusionStates[ro->objectId()];
+			state.lastTested = _frameSerial;
+			if (state.occluded)
+			{
+				_occludedList.push_back(ro);
+				_occludedTests.push_back((uint32_t)_occlusionSpheres.size());
+			}
+			else
+			{
+				_visibleList[kept++] = ro;
+			}
+			ids.push_back(ro->objectId());
+			_occlusionSpheres.push_back(ro->boundingSphere());
+		}
+		_visibleList.resize(kept);
+		_cullStats.occluded = (uint32_t)_occludedList.size();
+
+		_occlusionCuller->setSpheres(_occlusionSpheres);
+
+		//untested for a full swap chain cycle, gone or off screen
+		std::erase_if(_occlusionStates, [&](const auto& entry) { return _frameSerial - entry.second.lastTested > swapChain.framesInFlight(); });
+	}
+	void CommandDispatcher::setOcclusionCuller(std::shared_ptr<OcclusionCuller> culler)
+	{
+		_occlusionCuller = culler;
+		_occlusionStates.clear();
+		for (auto&& ids : _occlusionIds)
+			ids.clear();
+	}
+	void CommandDispatcher::setCullFrustum(const CullFrustum& frustum)
+	{
+		_frustum = frustum;
+		_frustumCulling = true;
+	}
+	void CommandDispatcher::disableCulling()
+	{
+		_frustumCulling = false;
+	}
+	CullStats CommandDispatcher::cullStats() const
+	{
+		return _cullStats;
+	}
+	std::span<const DispatchThreadStats> CommandDispatcher::threadStats() const
+	{
+		return _threadStats;
+	}
 	VkCommandBuffer CommandDispatcher::primaryCommandBuffer(size_t frame) const
 	{
 		return _primaryBuffers[frame];
 	}
+	void CommandDispatcher::addCuller(std::shared_ptr<GpuCuller> culler)
+	{
+		if (culler && std::find(_cullers.begin(), _cullers.end(), culler) == _cullers.end())
+			_cullers.push_back(culler);
+	}
+	void CommandDispatcher::removeCuller(const GpuCuller* culler)
+	{
+		std::erase_if(_cullers, [&](const std::shared_ptr<GpuCuller>& rhs) { return rhs.get() == culler; });
+	}
 	void CommandDispatcher::cleanUp(const Device& device)
 	{
-		for (auto&& thread : _threads)
-			thread->cleanUp(device);
-		vkFreeCommandBuffers(device.handle(), _commandPool, (uint32_t)_primaryBuffers.size(), _primaryBuffers.data());
-		vkDestroyCommandPool(device.handle(), _commandPool, nullptr);
+		_staticCache.clear();
+		_cullers.clear();
+		_occlusionCuller.reset();
+		_occlusionStates.clear();
+		for (auto&& recorder : _recorders)
+			recorder->cleanUp(device);
+		for (size_t frame = 0; frame < _commandPools.size(); ++frame)
+		{
+			vkFreeCommandBuffers(device.handle(), _commandPools[frame], 1, &_primaryBuffers[frame]);
+			vkDestroyCommandPool(device.handle(), _commandPools[frame], nullptr);
+		}
+		_commandPools.clear();
+		_primaryBuffers.clear();
 	}
 }
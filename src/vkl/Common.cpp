@@ -1,8 +1,11 @@
 #define VMA_IMPLEMENTATION
 #include <vkl/Common.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <set>
 #include <string>
+#include <cstring>
 
 #include <vkl/Device.h>
 #include <vkl/Window.h>
@@ -216,6 +219,66 @@ namespace vkl
 
 		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 	}
+	void createDeviceLocalBuffer(const Device& device, const SwapChain& swapChain, size_t frame, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess,
+		VkBuffer& buffer, VmaAllocation& memory, VkBuffer& stagingBuffer, VmaAllocation& stagingMemory) {
+		VkBufferCreateInfo stagingInfo{};
+		stagingInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		stagingInfo.size = size;
+		stagingInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		stagingInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo stagingAllocation{};
+		stagingAllocation.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+		stagingAllocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		stagingAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VmaAllocationInfo stagingMapping{};
+		if (vmaCreateBuffer(device.allocatorHandle(), &stagingInfo, &stagingAllocation, &stagingBuffer, &stagingMemory, &stagingMapping) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+		memcpy(stagingMapping.pMappedData, data, static_cast<size_t>(size));
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo allocation{};
+		allocation.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &allocation, &buffer, &memory, nullptr) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		VkCommandBuffer commandBuffer = swapChain.oneOffCommandBuffer(frame);
+
+		VkBufferCopy region{};
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = size;
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &region);
+
+		//the one off commands go ahead of the frame's draws in the same submit
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr
+		);
+	}
+
 	VKL_EXPORT void generateMipmaps(const Device& device, const SwapChain& swapChain, size_t frame, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
 		// Check if image format supports linear blitting
 		VkFormatProperties formatProperties;
@@ -301,4 +364,65 @@ namespace vkl
 			1, &barrier);
 
 	}
+
+	void DirtyRanges::add(size_t offset, size_t size)
+	{
+		if (size == 0)
+			return;
+
+		size_t end = size > SIZE_MAX - offset ? SIZE_MAX : offset + size;
+
+		//first interval ending at or after the new one's start, everything from there up to its end merges in
+		auto first = std::lower_bound(_ranges.begin(), _ranges.end(), offset, [](const Range& range, size_t value) { return range.offset + range.size < value; });
+		auto last = first;
+		while (last != _ranges.end() && last->offset <= end)
+		{
+			offset = std::min(offset, last->offset);
+			end = std::max(end, last->offset + last->size);
+			++last;
+		}
+		first = _ranges.erase(first, last);
+		_ranges.insert(first, { offset, end - offset });
+
+		if (_ranges.size() > MaxRanges)
+		{
+			Range all{ _ranges.front().offset, _ranges.back().offset + _ranges.back().size - _ranges.front().offset };
+			_ranges.assign(1, all);
+		}
+	}
+
+	void DirtyRanges::addAll()
+	{
+		_ranges.assign(1, { 0, SIZE_MAX });
+	}
+
+	void DirtyRanges::clear()
+	{
+		_ranges.clear();
+	}
+
+	bool DirtyRanges::empty() const
+	{
+		return _ranges.empty();
+	}
+
+	std::span<const DirtyRanges::Range> DirtyRanges::ranges() const
+	{
+		return _ranges;
+	}
+
+	size_t DirtyRanges::copy(void* dst, const void* src, size_t size)
+	{
+		size_t copied = 0;
+		for (const auto& range : _ranges)
+		{
+			if (range.offset >= size)
+				break;
+			size_t count = std::min(range.size, size - range.offset);
+			memcpy((char*)dst + range.offset, (const char*)src + range.offset, count);
+			copied += count;
+		}
+		_ranges.clear();
+		return copied;
+	}
 }
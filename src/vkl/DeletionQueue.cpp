@@ -0,0 +1,122 @@
+#include <vkl/DeletionQueue.h>
+
+#include <vkl/Device.h>
+
+#include <algorithm>
+
+namespace vkl
+{
+	void DeletionQueue::destroyBuffer(VkBuffer buffer, VmaAllocation memory)
+	{
+		if (buffer == VK_NULL_HANDLE && !memory)
+			return;
+		Entry entry;
+		entry.type = Type::Buffer;
+		entry.buffer = buffer;
+		entry.memory = memory;
+		push(entry);
+	}
+
+	void DeletionQueue::destroyImage(VkImage image, VmaAllocation memory)
+	{
+		if (image == VK_NULL_HANDLE && !memory)
+			return;
+		Entry entry;
+		entry.type = Type::Image;
+		entry.image = image;
+		entry.memory = memory;
+		push(entry);
+	}
+
+	void DeletionQueue::destroyImageView(VkImageView view)
+	{
+		if (view == VK_NULL_HANDLE)
+			return;
+		Entry entry;
+		entry.type = Type::ImageView;
+		entry.view = view;
+		push(entry);
+	}
+
+	void DeletionQueue::destroySampler(VkSampler sampler)
+	{
+		if (sampler == VK_NULL_HANDLE)
+			return;
+		Entry entry;
+		entry.type = Type::Sampler;
+		entry.sampler = sampler;
+		push(entry);
+	}
+
+	void DeletionQueue::destroyDescriptorPool(VkDescriptorPool pool)
+	{
+		if (pool == VK_NULL_HANDLE)
+			return;
+		Entry entry;
+		entry.type = Type::DescriptorPool;
+		entry.pool = pool;
+		push(entry);
+	}
+
+	void DeletionQueue::collect(const Device& device, size_t framesInFlight, std::chrono::nanoseconds budget)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		++_frameSerial;
+
+		auto start = std::chrono::steady_clock::now();
+		while (!_entries.empty() && _entries.front().serial + framesInFlight <= _frameSerial)
+		{
+			destroy(device, _entries.front());
+			_entries.pop_front();
+			if (std::chrono::steady_clock::now() - start >= budget)
+				break;
+		}
+	}
+
+	size_t DeletionQueue::pending() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _entries.size();
+	}
+
+	void DeletionQueue::cleanUp(const Device& device)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		for (auto&& entry : _entries)
+			destroy(device, entry);
+		_entries.clear();
+	}
+
+	void DeletionQueue::push(Entry& entry)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		//queued before the first collect, the first frame's submit may still use it
+		entry.serial = std::max<uint64_t>(_frameSerial, 1);
+		_entries.push_back(entry);
+	}
+
+	void DeletionQueue::destroy(const Device& device, const Entry& entry)
+	{
+		switch (entry.type)
+		{
+		case Type::Buffer:
+			vmaDestroyBuffer(device.allocatorHandle(), entry.buffer, entry.memory);
+			break;
+		case Type::Image:
+			vmaDestroyImage(device.allocatorHandle(), entry.image, entry.memory);
+			break;
+		case Type::ImageView:
+			vkDestroyImageView(device.handle(), entry.view, nullptr);
+			break;
+		case Type::Sampler:
+			vkDestroySampler(device.handle(), entry.sampler, nullptr);
+			break;
+		case Type::DescriptorPool:
+			vkDestroyDescriptorPool(device.handle(), entry.pool, nullptr);
+			break;
+		}
+	}
+}
@@ -0,0 +1,175 @@
+#include <vkl/DescriptorAllocator.h>
+
+#include <vkl/Device.h>
+#include <vkl/DeletionQueue.h>
+
+#include <algorithm>
+
+namespace vkl
+{
+	namespace
+	{
+		//pools per layout double in size up to the max
+		constexpr uint32_t FirstPoolSets = 64;
+		constexpr uint32_t MaxPoolSets = 4096;
+	}
+
+	void DescriptorAllocator::allocate(const Device& device, VkDescriptorSetLayout layout, std::span<const VkDescriptorPoolSize> perSetSizes, std::span<VkDescriptorSet> sets)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		LayoutPools& pools = _layouts[layout];
+		if (pools.pools.empty())
+		{
+			pools.perSetSizes.assign(perSetSizes.begin(), perSetSizes.end());
+			pools.nextPoolSize = FirstPoolSets;
+		}
+
+		size_t done = 0;
+
+		//recycled sets first
+		while (done < sets.size() && !pools.freeSets.empty())
+		{
+			sets[done++] = pools.freeSets.back();
+			pools.freeSets.pop_back();
+		}
+
+		while (done < sets.size())
+		{
+			bool freshPool = pools.remaining == 0;
+			if (freshPool)
+				addPool(device, pools);
+
+			uint32_t count = (uint32_t)std::min<size_t>(pools.remaining, sets.size() - done);
+			std::vector<VkDescriptorSetLayout> layouts(count, layout);
+
+			VkDescriptorSetAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = pools.pools.back();
+			allocInfo.descriptorSetCount = count;
+			allocInfo.pSetLayouts = layouts.data();
+
+			VkResult result = vkAllocateDescriptorSets(device.handle(), &allocInfo, sets.data() + done);
+			if (!freshPool && (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL))
+			{
+				//sizes didn't match what the layout really needs, move on to a fresh pool
+				pools.remaining = 0;
+				continue;
+			}
+			if (result != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			pools.remaining -= count;
+			done += count;
+		}
+
+		pools.inUse += (uint32_t)sets.size();
+	}
+
+	void DescriptorAllocator::free(VkDescriptorSetLayout layout, std::span<const VkDescriptorSet> sets)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		auto itr = _layouts.find(layout);
+		if (itr == _layouts.end())
+			return;
+
+		LayoutPools& pools = itr->second;
+		for (auto&& set : sets)
+		{
+			if (set != VK_NULL_HANDLE)
+			{
+				pools.pending.push_back({ _frameSerial, set });
+				--pools.inUse;
+			}
+		}
+	}
+
+	void DescriptorAllocator::collect(size_t framesInFlight)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		++_frameSerial;
+		for (auto&& [layout, pools] : _layouts)
+		{
+			//pending is in serial order, everything up front has cleared every frame slot
+			size_t ready = 0;
+			while (ready < pools.pending.size() && pools.pending[ready].serial + framesInFlight <= _frameSerial)
+				pools.freeSets.push_back(pools.pending[ready++].set);
+			pools.pending.erase(pools.pending.begin(), pools.pending.begin() + ready);
+		}
+	}
+
+	void DescriptorAllocator::releaseLayout(const Device& device, VkDescriptorSetLayout layout)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		auto itr = _layouts.find(layout);
+		if (itr == _layouts.end())
+			return;
+
+		for (auto&& pool : itr->second.pools)
+			device.deletionQueue().destroyDescriptorPool(pool);
+		//a layout created later may get the same handle, it has to start with fresh pools
+		_layouts.erase(itr);
+	}
+
+	DescriptorPoolStats DescriptorAllocator::stats() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		DescriptorPoolStats stats;
+		stats.layouts = (uint32_t)_layouts.size();
+		for (auto&& [layout, pools] : _layouts)
+		{
+			stats.pools += (uint32_t)pools.pools.size();
+			stats.setCapacity += pools.capacity;
+			stats.setsInUse += pools.inUse;
+			stats.setsFree += (uint32_t)pools.freeSets.size();
+			stats.setsPending += (uint32_t)pools.pending.size();
+		}
+		return stats;
+	}
+
+	void DescriptorAllocator::cleanUp(const Device& device)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		for (auto&& [layout, pools] : _layouts)
+		{
+			for (auto&& pool : pools.pools)
+				vkDestroyDescriptorPool(device.handle(), pool, nullptr);
+		}
+		_layouts.clear();
+	}
+
+	void DescriptorAllocator::addPool(const Device& device, LayoutPools& pools)
+	{
+		uint32_t setCount = pools.nextPoolSize;
+		pools.nextPoolSize = std::min(pools.nextPoolSize * 2, MaxPoolSets);
+
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (auto&& size : pools.perSetSizes)
+		{
+			if (size.descriptorCount == 0)
+				continue;
+			VkDescriptorPoolSize& poolSize = poolSizes.emplace_back(size);
+			poolSize.descriptorCount *= setCount;
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = setCount;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		if (vkCreateDescriptorPool(device.handle(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		pools.pools.push_back(pool);
+		pools.remaining = setCount;
+		pools.capacity += setCount;
+	}
+}
@@ -3,9 +3,13 @@
 #include <optional>
 #include <set>
 #include <string>
+#include <algorithm>
 
 #include <vkl/Instance.h>
 #include <vkl/Surface.h>
+#include <vkl/DescriptorAllocator.h>
+#include <vkl/DeletionQueue.h>
+#include <vkl/BindlessTextures.h>
 
 namespace vkl
 {
@@ -24,6 +28,11 @@ namespace vkl
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1)
+            return false;
+
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
@@ -42,14 +51,19 @@ namespace vkl
         createLogicalDevice(instance, surface);
 
         VmaAllocatorCreateInfo allocatorInfo = {};
-        allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_0;
+        allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
         allocatorInfo.physicalDevice = _physicalDevice;
         allocatorInfo.device = _device;
         allocatorInfo.instance = instance.handle();
 
         vmaCreateAllocator(&allocatorInfo, &_allocator);
+
+        _descriptorAllocator = std::make_unique<DescriptorAllocator>();
+        _deletionQueue = std::make_unique<DeletionQueue>();
     }
 
+    Device::~Device() = default;
+
     VkDevice Device::handle() const
     {
         return _device;
@@ -80,8 +94,80 @@ namespace vkl
         return _allocator;
     }
 
+    bool Device::pushDescriptorsSupported() const
+    {
+        return _cmdPushDescriptorSetWithTemplate != nullptr;
+    }
+
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR Device::cmdPushDescriptorSetWithTemplate() const
+    {
+        return _cmdPushDescriptorSetWithTemplate;
+    }
+
+    uint32_t Device::maxPushDescriptors() const
+    {
+        return _maxPushDescriptors;
+    }
+
+    VkDeviceSize Device::minUniformBufferOffsetAlignment() const
+    {
+        return _minUniformBufferOffsetAlignment;
+    }
+
+    uint32_t Device::maxDynamicUniformBuffers() const
+    {
+        return _maxDynamicUniformBuffers;
+    }
+
+    bool Device::bindlessSupported() const
+    {
+        return _bindlessSupported;
+    }
+
+    uint32_t Device::maxBindlessTextures() const
+    {
+        return _maxBindlessTextures;
+    }
+
+    bool Device::drawIndirectFirstInstanceSupported() const
+    {
+        return _drawIndirectFirstInstance;
+    }
+
+    bool Device::multiDrawIndirectSupported() const
+    {
+        return _multiDrawIndirect;
+    }
+
+    PFN_vkCmdDrawIndexedIndirectCountKHR Device::cmdDrawIndexedIndirectCount() const
+    {
+        return _cmdDrawIndexedIndirectCount;
+    }
+
+    PFN_vkCmdBeginConditionalRenderingEXT Device::cmdBeginConditionalRendering() const
+    {
+        return _cmdBeginConditionalRendering;
+    }
+
+    PFN_vkCmdEndConditionalRenderingEXT Device::cmdEndConditionalRendering() const
+    {
+        return _cmdEndConditionalRendering;
+    }
+
+    DescriptorAllocator& Device::descriptorAllocator() const
+    {
+        return *_descriptorAllocator;
+    }
+
+    DeletionQueue& Device::deletionQueue() const
+    {
+        return *_deletionQueue;
+    }
+
     void Device::cleanUp()
     {
+        _deletionQueue->cleanUp(*this);
+        _descriptorAllocator->cleanUp(*this);
         vmaDestroyAllocator(_allocator);
         vkDestroyDevice(_device, nullptr);
     }
@@ -136,8 +222,15 @@ namespace vkl
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+        _drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        _multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -147,8 +240,98 @@ namespace vkl
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(getVklDeviceExtensions().size());
-        createInfo.ppEnabledExtensionNames = getVklDeviceExtensions().data();
+        //optional extensions on top of the required ones
+        std::vector<const char*> extensions(getVklDeviceExtensions().begin(), getVklDeviceExtensions().end());
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        bool pushDescriptors = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+            return std::string(extension.extensionName) == VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME;
+            });
+        if (pushDescriptors)
+            extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+        bool drawIndirectCount = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+            return std::string(extension.extensionName) == VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME;
+            });
+        if (drawIndirectCount)
+            extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+        //bindless needs non uniform indexing into a partially bound, update after bind array
+        bool descriptorIndexing = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+            return std::string(extension.extensionName) == VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+            });
+
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        if (descriptorIndexing)
+        {
+            VkPhysicalDeviceFeatures2 supported{};
+            supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supported.pNext = &indexingFeatures;
+            vkGetPhysicalDeviceFeatures2(_physicalDevice, &supported);
+
+            _bindlessSupported = indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+                && indexingFeatures.descriptorBindingPartiallyBound && indexingFeatures.runtimeDescriptorArray;
+        }
+
+        //second phase occlusion draws are predicated on the gpu's own visibility results
+        bool conditionalRendering = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties& extension) {
+            return std::string(extension.extensionName) == VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME;
+            });
+
+        VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalFeatures{};
+        conditionalFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+        if (conditionalRendering)
+        {
+            VkPhysicalDeviceFeatures2 supported{};
+            supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            supported.pNext = &conditionalFeatures;
+            vkGetPhysicalDeviceFeatures2(_physicalDevice, &supported);
+            conditionalRendering = conditionalFeatures.conditionalRendering;
+        }
+
+        VkPhysicalDeviceFeatures2 enabledFeatures{};
+        enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        enabledFeatures.features = deviceFeatures;
+        if (conditionalRendering)
+        {
+            extensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+
+            conditionalFeatures = {};
+            conditionalFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+            conditionalFeatures.conditionalRendering = VK_TRUE;
+            conditionalFeatures.pNext = enabledFeatures.pNext;
+            enabledFeatures.pNext = &conditionalFeatures;
+
+            createInfo.pNext = &enabledFeatures;
+            createInfo.pEnabledFeatures = nullptr;
+        }
+        if (_bindlessSupported)
+        {
+            extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+            VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported = indexingFeatures;
+            indexingFeatures = {};
+            indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending = supported.descriptorBindingUpdateUnusedWhilePending;
+            indexingFeatures.pNext = enabledFeatures.pNext;
+            enabledFeatures.pNext = &indexingFeatures;
+
+            //features go through the pNext chain once there is one
+            createInfo.pNext = &enabledFeatures;
+            createInfo.pEnabledFeatures = nullptr;
+        }
+
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         if (!instance.getLayers().empty()) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(instance.getLayers().size());
@@ -165,5 +348,48 @@ namespace vkl
         vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
         vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
 
+        if (drawIndirectCount)
+            _cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCountKHR");
+
+        if (conditionalRendering)
+        {
+            _cmdBeginConditionalRendering = (PFN_vkCmdBeginConditionalRenderingEXT)vkGetDeviceProcAddr(_device, "vkCmdBeginConditionalRenderingEXT");
+            _cmdEndConditionalRendering = (PFN_vkCmdEndConditionalRenderingEXT)vkGetDeviceProcAddr(_device, "vkCmdEndConditionalRenderingEXT");
+        }
+
+        VkPhysicalDeviceProperties deviceProperties{};
+        vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+        _minUniformBufferOffsetAlignment = std::max<VkDeviceSize>(deviceProperties.limits.minUniformBufferOffsetAlignment, 1);
+        _maxDynamicUniformBuffers = deviceProperties.limits.maxDescriptorSetUniformBuffersDynamic;
+
+        if (pushDescriptors)
+        {
+            _cmdPushDescriptorSetWithTemplate = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(_device, "vkCmdPushDescriptorSetWithTemplateKHR");
+
+            VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties{};
+            pushProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &pushProperties;
+            vkGetPhysicalDeviceProperties2(_physicalDevice, &properties);
+            _maxPushDescriptors = pushProperties.maxPushDescriptors;
+        }
+
+        if (_bindlessSupported)
+        {
+            VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+            indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &indexingProperties;
+            vkGetPhysicalDeviceProperties2(_physicalDevice, &properties);
+
+            //a combined image sampler counts as both a sampler and a sampled image, per stage the pipeline's own textures come out of the same limits
+            uint32_t limit = std::min({ indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                indexingProperties.maxPerStageUpdateAfterBindResources, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+            _maxBindlessTextures = limit > BindlessReservedTextures ? std::min(limit - BindlessReservedTextures, MaxBindlessTextures) : 0;
+            _bindlessSupported = _maxBindlessTextures > 0;
+        }
+
     }
 }
\ No newline at end of file
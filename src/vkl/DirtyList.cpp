@@ -0,0 +1,145 @@
+#include <vkl/DirtyList.h>
+
+#include <cstring>
+
+namespace vkl
+{
+	uint64_t contentHash(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t hash = 14695981039346656037ull ^ size;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+			hash ^= hash >> 32;
+		}
+		for (; i < size; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	bool ContentHash::unchanged(const void* data, size_t size)
+	{
+		uint64_t hash = data ? contentHash(data, size) : 0;
+		bool same = _valid && _size == size && _hash == hash;
+		_hash = hash;
+		_size = size;
+		_valid = true;
+		return same;
+	}
+
+	void ContentHash::reset()
+	{
+		_valid = false;
+	}
+
+	DirtyNode::~DirtyNode()
+	{
+		if (_dirtyList)
+			_dirtyList->detach(*this);
+	}
+
+	bool DirtyNode::queued() const
+	{
+		return _queued.load(std::memory_order_acquire);
+	}
+
+	void DirtyNode::markDirty()
+	{
+		//already queued is the common case, it doesn't need the list's lock
+		if (_dirtyList && !_queued.load(std::memory_order_acquire))
+			_dirtyList->queue(*this);
+	}
+
+	DirtyList::~DirtyList()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_head)
+			unlink(*_head);
+	}
+
+	void DirtyList::attach(DirtyNode& node)
+	{
+		if (node._dirtyList == this)
+			return;
+		if (node._dirtyList)
+			node._dirtyList->detach(node);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		node._dirtyList = this;
+		push(node);
+	}
+
+	void DirtyList::detach(DirtyNode& node)
+	{
+		if (node._dirtyList != this)
+			return;
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		unlink(node);
+		node._dirtyList = nullptr;
+	}
+
+	void DirtyList::flush(const Device& device, const SwapChain& swapChain)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		for (DirtyNode* node = _head; node;)
+		{
+			DirtyNode* next = node->_dirtyNext;
+			if (!node->flushDirty(device, swapChain))
+				unlink(*node);
+			node = next;
+		}
+	}
+
+	size_t DirtyList::size() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _size;
+	}
+
+	void DirtyList::queue(DirtyNode& node)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		push(node);
+	}
+
+	void DirtyList::push(DirtyNode& node)
+	{
+		if (node._queued.load(std::memory_order_relaxed))
+			return;
+
+		node._dirtyPrev = _tail;
+		node._dirtyNext = nullptr;
+		if (_tail)
+			_tail->_dirtyNext = &node;
+		else
+			_head = &node;
+		_tail = &node;
+		node._queued.store(true, std::memory_order_release);
+		++_size;
+	}
+
+	void DirtyList::unlink(DirtyNode& node)
+	{
+		if (!node._queued.load(std::memory_order_relaxed))
+			return;
+
+		if (node._dirtyPrev)
+			node._dirtyPrev->_dirtyNext = node._dirtyNext;
+		else
+			_head = node._dirtyNext;
+		if (node._dirtyNext)
+			node._dirtyNext->_dirtyPrev = node._dirtyPrev;
+		else
+			_tail = node._dirtyPrev;
+		node._dirtyPrev = nullptr;
+		node._dirtyNext = nullptr;
+		node._queued.store(false, std::memory_order_release);
+		--_size;
+	}
+}
@@ -1,8 +1,9 @@
 #include <vkl/DrawCall.h>
+#include <vkl/IndexBuffer.h>
 
 namespace vkl
 {
-	std::shared_ptr<const IndexBuffer> DrawCall::indexBuffer() const
+	const std::shared_ptr<const IndexBuffer>& DrawCall::indexBuffer() const
 	{
 		return _indexBuffer;
 	}
@@ -14,16 +15,73 @@ namespace vkl
 	{
 		return _offset;
 	}
+	int32_t DrawCall::vertexOffset() const
+	{
+		return _vertexOffset;
+	}
+	VkIndexType DrawCall::indexType() const
+	{
+		return _indexBuffer ? _indexBuffer->indexType() : VK_INDEX_TYPE_UINT32;
+	}
+	size_t DrawCall::instanceCount() const
+	{
+		return _instanceCount;
+	}
+	size_t DrawCall::firstInstance() const
+	{
+		return _firstInstance;
+	}
 	void DrawCall::setIndexBuffer(std::shared_ptr<const IndexBuffer> buffer)
 	{
 		_indexBuffer = buffer;
+		++_packetVersion;
 	}
 	void DrawCall::setCount(size_t count)
 	{
 		_count = count;
+		++_packetVersion;
 	}
 	void DrawCall::setOffset(size_t offset)
 	{
 		_offset = offset;
+		++_packetVersion;
+	}
+	void DrawCall::setVertexOffset(int32_t vertexOffset)
+	{
+		_vertexOffset = vertexOffset;
+		++_packetVersion;
+	}
+	void DrawCall::setInstanceCount(size_t instanceCount)
+	{
+		_instanceCount = instanceCount;
+		++_packetVersion;
+	}
+	void DrawCall::setFirstInstance(size_t firstInstance)
+	{
+		_firstInstance = firstInstance;
+		++_packetVersion;
+	}
+	void DrawCall::setIndirect(std::shared_ptr<const GpuCuller> culler, uint32_t firstDraw, uint32_t drawCount)
+	{
+		_indirect = culler;
+		_indirectFirstDraw = firstDraw;
+		_indirectDrawCount = drawCount;
+		++_packetVersion;
+	}
+	const std::shared_ptr<const GpuCuller>& DrawCall::indirect() const
+	{
+		return _indirect;
+	}
+	uint32_t DrawCall::indirectFirstDraw() const
+	{
+		return _indirectFirstDraw;
+	}
+	uint32_t DrawCall::indirectDrawCount() const
+	{
+		return _indirectDrawCount;
+	}
+	uint64_t DrawCall::packetVersion() const
+	{
+		return _packetVersion;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <vkl/DrawPacket.h>
+#include <vkl/BindlessTextures.h>
+
+#include <algorithm>
+
+namespace vkl
+{
+	void CommandStateTracker::reset()
+	{
+		_pipeline = VK_NULL_HANDLE;
+		_layout = VK_NULL_HANDLE;
+		_descriptorSet = VK_NULL_HANDLE;
+		_bindlessLayout = VK_NULL_HANDLE;
+		_bindlessSet = VK_NULL_HANDLE;
+		_indexBuffer = VK_NULL_HANDLE;
+		_scissorSet = false;
+		_vertexBufferCount = 0;
+	}
+
+	void CommandStateTracker::record(VkCommandBuffer buffer, const DrawPacket& packet, const PacketDraw* draws, const VkExtent2D& extent)
+	{
+		if (packet.pipeline != _pipeline)
+		{
+			vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+			_pipeline = packet.pipeline;
+			++_issued;
+		}
+		else
+		{
+			++_skipped;
+		}
+
+		//only rebind the span of bindings that actually differ
+		if (packet.vertexBufferCount > 0)
+		{
+			uint32_t first = packet.vertexBufferCount;
+			uint32_t last = 0;
+			for (uint32_t i = 0; i < packet.vertexBufferCount; ++i)
+			{
+				if (i >= _vertexBufferCount || _vertexBuffers[i] != packet.vertexBuffers[i] || _vertexOffsets[i] != packet.vertexOffsets[i])
+				{
+					first = std::min(first, i);
+					last = i + 1;
+				}
+			}
+			if (first < last)
+			{
+				vkCmdBindVertexBuffers(buffer, first, last - first, packet.vertexBuffers + first, packet.vertexOffsets + first);
+				for (uint32_t i = first; i < last; ++i)
+				{
+					_vertexBuffers[i] = packet.vertexBuffers[i];
+					_vertexOffsets[i] = packet.vertexOffsets[i];
+				}
+				_vertexBufferCount = std::max(_vertexBufferCount, last);
+				++_issued;
+			}
+			else
+			{
+				++_skipped;
+			}
+		}
+
+		if (packet.pushDescriptorData)
+		{
+			//contents live in the object and may have changed, always push
+			packet.pushDescriptors(buffer, packet.pushTemplate, packet.layout, 0, packet.pushDescriptorData);
+			_layout = packet.layout;
+			_descriptorSet = VK_NULL_HANDLE;
+			++_issued;
+		}
+		else if (packet.descriptorSet != VK_NULL_HANDLE)
+		{
+			//a different layout can disturb set 0, so only trust the cached set while the layout matches
+			//sets are per object and frame, so the same set also means the same dynamic offsets
+			if (packet.layout != _layout || packet.descriptorSet != _descriptorSet)
+			{
+				vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.layout, 0, 1, &packet.descriptorSet, packet.dynamicOffsetCount, packet.dynamicOffsets);
+				_layout = packet.layout;
+				_descriptorSet = packet.descriptorSet;
+				++_issued;
+			}
+			else
+			{
+				++_skipped;
+			}
+		}
+
+		//the table stays bound across objects as long as they share the pipeline layout
+		if (packet.bindlessSet != VK_NULL_HANDLE)
+		{
+			if (packet.layout != _bindlessLayout || packet.bindlessSet != _bindlessSet)
+			{
+				vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.layout, BindlessTextureSet, 1, &packet.bindlessSet, 0, nullptr);
+				_bindlessLayout = packet.layout;
+				_bindlessSet = packet.bindlessSet;
+				++_issued;
+			}
+			else
+			{
+				++_skipped;
+			}
+		}
+
+		//contents can differ between objects sharing a pointer, always push
+		if (packet.pushConstantData)
+		{
+			vkCmdPushConstants(buffer, packet.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, packet.pushConstantSize, packet.pushConstantData);
+			++_issued;
+		}
+
+		if (packet.drawCount == 0)
+			return;
+
+		//TODO - let draw calls scissor
+		if (!_scissorSet || _scissor.width != extent.width || _scissor.height != extent.height)
+		{
+			VkRect2D scissor{};
+			scissor.offset = { 0, 0 };
+			scissor.extent = extent;
+			vkCmdSetScissor(buffer, 0, 1, &scissor);
+			_scissorSet = true;
+			_scissor = extent;
+			++_issued;
+		}
+		else
+		{
+			++_skipped;
+		}
+
+		const PacketDraw* end = draws + packet.firstDraw + packet.drawCount;
+		for (const PacketDraw* draw = draws + packet.firstDraw; draw != end; ++draw)
+		{
+			if (draw->indexBuffer)
+			{
+				if (draw->indexBuffer != _indexBuffer || draw->indexType != _indexType)
+				{
+					vkCmdBindIndexBuffer(buffer, draw->indexBuffer, 0, draw->indexType);
+					_indexBuffer = draw->indexBuffer;
+					_indexType = draw->indexType;
+					++_issued;
+				}
+				else
+				{
+					++_skipped;
+				}
+				if (draw->countBuffer)
+					packet.drawIndirectCount(buffer, draw->indirectBuffer, draw->indirectOffset, draw->countBuffer, 0, draw->count, sizeof(VkDrawIndexedIndirectCommand));
+				else if (draw->indirectBuffer)
+					vkCmdDrawIndexedIndirect(buffer, draw->indirectBuffer, draw->indirectOffset, draw->count, sizeof(VkDrawIndexedIndirectCommand));
+				else
+					vkCmdDrawIndexed(buffer, draw->count, draw->instanceCount, draw->offset, draw->vertexOffset, draw->firstInstance);
+			}
+			else
+			{
+				vkCmdDraw(buffer, draw->count, draw->instanceCount, draw->offset, draw->firstInstance);
+			}
+		}
+	}
+
+	uint32_t CommandStateTracker::issued() const
+	{
+		return _issued;
+	}
+
+	uint32_t CommandStateTracker::skipped() const
+	{
+		return _skipped;
+	}
+
+	void recordDrawPacket(VkCommandBuffer buffer, const DrawPacket& packet, const PacketDraw* draws, const VkExtent2D& extent)
+	{
+		CommandStateTracker state;
+		state.record(buffer, packet, draws, extent);
+	}
+}
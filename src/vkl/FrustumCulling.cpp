@@ -0,0 +1,105 @@
+#include <vkl/FrustumCulling.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#include <immintrin.h>
+#define VKL_CULL_SSE 1
+#endif
+
+namespace vkl
+{
+	namespace
+	{
+		size_t cullScalar(const CullFrustum& frustum, const CullSpheres& spheres, size_t begin, uint8_t* visible)
+		{
+			size_t visibleCount = 0;
+			for (size_t i = begin; i < spheres.count; ++i)
+			{
+				bool inside = true;
+				for (auto&& plane : frustum.planes)
+				{
+					float distance = plane[0] * spheres.x[i] + plane[1] * spheres.y[i] + plane[2] * spheres.z[i] + plane[3];
+					inside = inside && distance >= -spheres.radius[i];
+				}
+				visible[i] = inside ? 1 : 0;
+				visibleCount += visible[i];
+			}
+			return visibleCount;
+		}
+
+		void writeMask(uint32_t mask, size_t lanes, uint8_t* visible)
+		{
+			for (size_t lane = 0; lane < lanes; ++lane)
+				visible[lane] = (mask >> lane) & 1;
+		}
+
+		uint32_t countBits(uint32_t mask)
+		{
+			uint32_t count = 0;
+			for (; mask; mask &= mask - 1)
+				++count;
+			return count;
+		}
+	}
+
+	size_t cullSpheres(const CullFrustum& frustum, const CullSpheres& spheres, uint8_t* visible)
+	{
+		size_t i = 0;
+		size_t visibleCount = 0;
+
+#if defined(__AVX__)
+		{
+			__m256 planes[6][4];
+			for (size_t p = 0; p < 6; ++p)
+				for (size_t c = 0; c < 4; ++c)
+					planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+
+			for (; i + 8 <= spheres.count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(spheres.x + i);
+				__m256 y = _mm256_loadu_ps(spheres.y + i);
+				__m256 z = _mm256_loadu_ps(spheres.z + i);
+				__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (auto&& plane : planes)
+				{
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[0], x), _mm256_mul_ps(plane[1], y)), _mm256_add_ps(_mm256_mul_ps(plane[2], z), plane[3]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+				}
+				uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+				writeMask(mask, 8, visible + i);
+				visibleCount += countBits(mask);
+			}
+		}
+#endif
+
+#if defined(VKL_CULL_SSE)
+		{
+			__m128 planes[6][4];
+			for (size_t p = 0; p < 6; ++p)
+				for (size_t c = 0; c < 4; ++c)
+					planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+
+			for (; i + 4 <= spheres.count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(spheres.x + i);
+				__m128 y = _mm_loadu_ps(spheres.y + i);
+				__m128 z = _mm_loadu_ps(spheres.z + i);
+				__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (auto&& plane : planes)
+				{
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], x), _mm_mul_ps(plane[1], y)), _mm_add_ps(_mm_mul_ps(plane[2], z), plane[3]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+				}
+				uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+				writeMask(mask, 4, visible + i);
+				visibleCount += countBits(mask);
+			}
+		}
+#endif
+
+		return visibleCount + cullScalar(frustum, spheres, i, visible);
+	}
+}
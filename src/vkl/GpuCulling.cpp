@@ -0,0 +1,447 @@
+#include <vkl/GpuCulling.h>
+
+#include <vkl/Device.h>
+#include <vkl/SwapChain.h>
+#include <vkl/Shader.h>
+#include <vkl/DescriptorAllocator.h>
+#include <vkl/DeletionQueue.h>
+
+#include <array>
+#include <cstring>
+
+namespace vkl
+{
+	namespace
+	{
+		constexpr uint32_t CullGroupSize = 64;
+
+		constexpr uint32_t _Binding_Instances = 0;
+		constexpr uint32_t _Binding_Commands = 1;
+		constexpr uint32_t _Binding_Visible = 2;
+		constexpr uint32_t _Binding_Compacted = 3;
+		constexpr uint32_t _Binding_Count = 4;
+		constexpr uint32_t BindingCount = 5;
+
+		//pass 0 culls one instance per thread, pass 1 compacts one draw per thread
+		constexpr const char* CullShader = R"Shader(
+
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct Instance
+{
+	mat4 transform;
+	vec4 sphere;
+	uvec4 draw;
+};
+
+struct Command
+{
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) buffer Commands { Command commands[]; };
+layout(std430, binding = 2) writeonly buffer Visible { mat4 visible[]; };
+layout(std430, binding = 3) writeonly buffer Compacted { Command compacted[]; };
+layout(std430, binding = 4) buffer Count { uint drawCount; };
+
+layout(push_constant) uniform Cull {
+	vec4 planes[6];
+	uint instanceCount;
+	uint commandCount;
+	uint pass;
+} u_cull;
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+
+	if(u_cull.pass == 0)
+	{
+		if(index >= u_cull.instanceCount)
+			return;
+
+		vec4 sphere = instances[index].sphere;
+		for(int i = 0; i < 6; ++i)
+		{
+			if(dot(u_cull.planes[i].xyz, sphere.xyz) + u_cull.planes[i].w < -sphere.w)
+				return;
+		}
+
+		uint draw = instances[index].draw.x;
+		uint slot = atomicAdd(commands[draw].instanceCount, 1);
+		visible[commands[draw].firstInstance + slot] = instances[index].transform;
+	}
+	else
+	{
+		if(index >= u_cull.commandCount)
+			return;
+
+		Command command = commands[index];
+		if(command.instanceCount == 0)
+			return;
+
+		compacted[atomicAdd(drawCount, 1)] = command;
+	}
+}
+
+)Shader";
+
+		struct CullConstants
+		{
+			float planes[6][4];
+			uint32_t instanceCount;
+			uint32_t commandCount;
+			uint32_t pass;
+		};
+
+		uint32_t groupCount(size_t count)
+		{
+			return (uint32_t)((count + CullGroupSize - 1) / CullGroupSize);
+		}
+
+		void computeBarrier(VkCommandBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(buffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+	}
+
+	GpuCuller::GpuCuller(const Device& device, const SwapChain& swapChain)
+	{
+		//draws start at their firstInstance in the visible buffer
+		if (!device.drawIndirectFirstInstanceSupported())
+		{
+			throw std::runtime_error("Error");
+		}
+
+		_cmdDrawIndexedIndirectCount = device.cmdDrawIndexedIndirectCount();
+		_multiDrawIndirect = device.multiDrawIndirectSupported();
+		_frames.resize(swapChain.framesInFlight());
+
+		createPipeline(device);
+	}
+
+	void GpuCuller::createPipeline(const Device& device)
+	{
+		std::array<VkDescriptorSetLayoutBinding, BindingCount> bindings{};
+		for (uint32_t i = 0; i < BindingCount; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorCount = 1;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = (uint32_t)bindings.size();
+		layoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(device.handle(), &layoutInfo, nullptr, &_setLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &_setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device.handle(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		ShaderModule shaderModule(device, std::make_shared<GLSLShader>(CullShader, VK_SHADER_STAGE_COMPUTE_BIT), VK_SHADER_STAGE_COMPUTE_BIT);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule.handle();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = _pipelineLayout;
+
+		VkResult result = vkCreateComputePipelines(device.handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_pipeline);
+		vkDestroyShaderModule(device.handle(), shaderModule.handle(), nullptr);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+	}
+
+	void GpuCuller::setDraws(std::span<const CullDraw> draws)
+	{
+		_draws.assign(draws.begin(), draws.end());
+		buildCommands();
+		markDirty();
+		//packets pick the compacted path by draw count
+		++_packetVersion;
+	}
+
+	void GpuCuller::setInstances(std::span<const CullInstance> instances)
+	{
+		_instances.assign(instances.begin(), instances.end());
+		buildCommands();
+		markDirty();
+	}
+
+	void GpuCuller::setFrustum(const CullFrustum& frustum)
+	{
+		_frustum = frustum;
+	}
+
+	uint32_t GpuCuller::drawCount() const
+	{
+		return (uint32_t)_draws.size();
+	}
+
+	uint32_t GpuCuller::instanceCount() const
+	{
+		return (uint32_t)_instances.size();
+	}
+
+	void GpuCuller::buildCommands()
+	{
+		_commands.assign(_draws.size(), {});
+		for (auto&& instance : _instances)
+		{
+			if (instance.draw >= _draws.size())
+			{
+				throw std::runtime_error("Error");
+			}
+			++_commands[instance.draw].instanceCount;
+		}
+
+		uint32_t firstInstance = 0;
+		for (size_t i = 0; i < _draws.size(); ++i)
+		{
+			auto& command = _commands[i];
+			command.indexCount = _draws[i].indexCount;
+			command.firstIndex = _draws[i].firstIndex;
+			command.vertexOffset = _draws[i].vertexOffset;
+			command.firstInstance = firstInstance;
+			firstInstance += command.instanceCount;
+			//counted back up by the cull pass
+			command.instanceCount = 0;
+		}
+	}
+
+	void GpuCuller::markDirty()
+	{
+		for (auto&& frame : _frames)
+			frame.dirty = true;
+	}
+
+	void GpuCuller::update(const Device& device, const SwapChain& swapChain)
+	{
+		FrameData& data = _frames[swapChain.frame()];
+		if (!data.dirty)
+			return;
+		data.dirty = false;
+
+		//only grows, the old buffer goes once every frame that may still read it has finished
+		auto reserve = [&](Allocation& allocation, size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+			size = std::max<size_t>(size, 16);
+			if (allocation.buffer && allocation.size >= size)
+				return false;
+
+			if (allocation.buffer)
+				device.deletionQueue().destroyBuffer(allocation.buffer, allocation.memory);
+			allocation = {};
+
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = size;
+			bufferInfo.usage = usage;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VmaAllocationCreateInfo createAllocation{};
+			createAllocation.usage = memoryUsage;
+			if (memoryUsage == VMA_MEMORY_USAGE_CPU_TO_GPU)
+			{
+				createAllocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+			}
+
+			VmaAllocationInfo info{};
+			if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &allocation.buffer, &allocation.memory, &info) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			allocation.mapped = info.pMappedData;
+			allocation.size = size;
+			return true;
+		};
+
+		size_t commandSize = _commands.size() * CommandStride;
+		bool recreated = false;
+		recreated |= reserve(data.instances, _instances.size() * sizeof(CullInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+		recreated |= reserve(data.commandTemplate, commandSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+		recreated |= reserve(data.commands, commandSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		recreated |= reserve(data.compacted, commandSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		recreated |= reserve(data.count, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		recreated |= reserve(data.visible, _instances.size() * sizeof(CullInstance::transform), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+		if (data.instances.mapped && !_instances.empty())
+			memcpy(data.instances.mapped, _instances.data(), _instances.size() * sizeof(CullInstance));
+		if (data.commandTemplate.mapped && !_commands.empty())
+			memcpy(data.commandTemplate.mapped, _commands.data(), commandSize);
+
+		if (!recreated)
+			return;
+
+		//packets hold the old handles
+		++_packetVersion;
+
+		if (!data.set)
+		{
+			VkDescriptorPoolSize poolSize{};
+			poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			poolSize.descriptorCount = BindingCount;
+			device.descriptorAllocator().allocate(device, _setLayout, std::span<const VkDescriptorPoolSize>(&poolSize, 1), std::span<VkDescriptorSet>(&data.set, 1));
+		}
+
+		std::array<const Allocation*, BindingCount> allocations{};
+		allocations[_Binding_Instances] = &data.instances;
+		allocations[_Binding_Commands] = &data.commands;
+		allocations[_Binding_Visible] = &data.visible;
+		allocations[_Binding_Compacted] = &data.compacted;
+		allocations[_Binding_Count] = &data.count;
+
+		std::array<VkDescriptorBufferInfo, BindingCount> bufferInfos{};
+		std::array<VkWriteDescriptorSet, BindingCount> writes{};
+		for (uint32_t i = 0; i < BindingCount; ++i)
+		{
+			bufferInfos[i].buffer = allocations[i]->buffer;
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = data.set;
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		vkUpdateDescriptorSets(device.handle(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+	}
+
+	void GpuCuller::recordCull(VkCommandBuffer buffer, size_t frame) const
+	{
+		const FrameData& data = _frames[frame];
+		if (_commands.empty() || !data.set)
+			return;
+
+		//reset to the template, instance counts go back to 0
+		VkBufferCopy copy{};
+		copy.size = _commands.size() * CommandStride;
+		vkCmdCopyBuffer(buffer, data.commandTemplate.buffer, data.commands.buffer, 1, &copy);
+		vkCmdFillBuffer(buffer, data.count.buffer, 0, sizeof(uint32_t), 0);
+
+		computeBarrier(buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+		vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &data.set, 0, nullptr);
+
+		CullConstants constants{};
+		memcpy(constants.planes, _frustum.planes, sizeof(constants.planes));
+		constants.instanceCount = (uint32_t)_instances.size();
+		constants.commandCount = (uint32_t)_commands.size();
+
+		if (!_instances.empty())
+		{
+			constants.pass = 0;
+			vkCmdPushConstants(buffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+			vkCmdDispatch(buffer, groupCount(_instances.size()), 1, 1);
+
+			computeBarrier(buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+		}
+
+		constants.pass = 1;
+		vkCmdPushConstants(buffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(buffer, groupCount(_commands.size()), 1, 1);
+
+		computeBarrier(buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+	}
+
+	VkBuffer GpuCuller::commandBuffer(size_t frame) const
+	{
+		return _frames[frame].commands.buffer;
+	}
+
+	VkBuffer GpuCuller::compactedCommandBuffer(size_t frame) const
+	{
+		return _frames[frame].compacted.buffer;
+	}
+
+	VkBuffer GpuCuller::countBuffer(size_t frame) const
+	{
+		return _frames[frame].count.buffer;
+	}
+
+	VkBuffer GpuCuller::visibleInstanceBuffer(size_t frame) const
+	{
+		return _frames[frame].visible.buffer;
+	}
+
+	uint64_t GpuCuller::packetVersion() const
+	{
+		return _packetVersion;
+	}
+
+	PFN_vkCmdDrawIndexedIndirectCountKHR GpuCuller::cmdDrawIndexedIndirectCount() const
+	{
+		return _cmdDrawIndexedIndirectCount;
+	}
+
+	bool GpuCuller::multiDrawIndirect() const
+	{
+		return _multiDrawIndirect;
+	}
+
+	void GpuCuller::cleanUp(const Device& device)
+	{
+		for (auto&& data : _frames)
+		{
+			for (Allocation* allocation : { &data.instances, &data.commandTemplate, &data.commands, &data.compacted, &data.count, &data.visible })
+			{
+				if (allocation->buffer)
+					device.deletionQueue().destroyBuffer(allocation->buffer, allocation->memory);
+				*allocation = {};
+			}
+			data.set = VK_NULL_HANDLE;
+			data.dirty = true;
+		}
+
+		if (_pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(device.handle(), _pipeline, nullptr);
+		if (_pipelineLayout != VK_NULL_HANDLE)
+			vkDestroyPipelineLayout(device.handle(), _pipelineLayout, nullptr);
+		if (_setLayout != VK_NULL_HANDLE)
+		{
+			//the frames' sets go with the layout's pools
+			device.descriptorAllocator().releaseLayout(device, _setLayout);
+			vkDestroyDescriptorSetLayout(device.handle(), _setLayout, nullptr);
+		}
+		_pipeline = VK_NULL_HANDLE;
+		_pipelineLayout = VK_NULL_HANDLE;
+		_setLayout = VK_NULL_HANDLE;
+	}
+}
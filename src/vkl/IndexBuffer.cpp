@@ -1,61 +1,116 @@
 #include <vkl/IndexBuffer.h>
 #include <vkl/Device.h>
 #include <vkl/SwapChain.h>
+#include <vkl/DeletionQueue.h>
 
+#include <algorithm>
 #include <cstring>
 
 namespace vkl
 {
 
-    IndexBuffer::IndexBuffer(const Device& device, const SwapChain& swapChain)
+    IndexBuffer::IndexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage)
+        : _usage(usage)
     {
-        _buffers.resize(swapChain.framesInFlight());
+        _buffers.resize(_usage == BufferUsage::Static ? 1 : swapChain.framesInFlight());
+        _dirties.resize(swapChain.framesInFlight());
     }
 
     void IndexBuffer::setData(std::span<const uint32_t> indices)
     {
-        _data = (void*)indices.data();
-        _elementSize = sizeof(uint32_t);
-        _oldCount = _count;
-        _count = indices.size();
-        _dirty = std::numeric_limits<int>::max();
+        setData(indices.data(), sizeof(uint32_t), indices.size());
     }
 
-    void IndexBuffer::update(const Device& device, const SwapChain& swapChain)
+    void IndexBuffer::setData(std::span<const uint16_t> indices)
     {
-        if (_dirty == swapChain.frame())
-            _dirty = -1;
+        setData(indices.data(), sizeof(uint16_t), indices.size());
+    }
+
+    void IndexBuffer::setData(const void* data, size_t elementSize, size_t count)
+    {
+        //packets bake the index type in, even when the size in bytes comes out the same
+        if (_elementSize != elementSize)
+            ++_packetVersion;
+
+        bool unchanged = _changeDetection && _contentHash.unchanged(data, elementSize * count) && elementSize == _elementSize && count == _count;
 
-        if (_dirty == -1)
+        _data = (void*)data;
+        _elementSize = elementSize;
+        _count = count;
+        if (unchanged)
             return;
 
-        if (_dirty == std::numeric_limits<int>::max())
-            _dirty = (int)swapChain.frame();
+        for (auto&& dirty : _dirties)
+            dirty.addAll();
+        markDirty();
+    }
+
+    void IndexBuffer::updateRange(size_t offset, size_t size)
+    {
+        _contentHash.reset();
+        for (auto&& dirty : _dirties)
+            dirty.add(offset, size);
+        markDirty();
+    }
+
+    void IndexBuffer::update(const Device& device, const SwapChain& swapChain)
+    {
+        auto& dirty = _dirties[swapChain.frame()];
+        if (dirty.empty())
+            return;
+
+        if (_usage == BufferUsage::Static)
+        {
+            //one upload covers every frame, a range update re-uploads it all
+            for (auto&& frameDirty : _dirties)
+                frameDirty.clear();
+            updateStatic(device, swapChain);
+            return;
+        }
 
         auto& current = _buffers[swapChain.frame()];
+        size_t size = _elementSize * _count;
 
-        if (_oldCount != _count && isValid(swapChain.frame()))
+        //grow geometrically, only shrink once the data stayed well under capacity for a while
+        size_t capacity = current._capacity;
+        if (size > capacity)
         {
-            //destroy buffer
-            if (current._buffer && current._memory)
-            {
-                vmaDestroyBuffer(device.allocatorHandle(), current._buffer, current._memory);
-                current._memory = nullptr;
-                current._buffer = VK_NULL_HANDLE;
-                current._mapped = nullptr;
-            }
+            capacity = std::max(size, capacity * 2);
+        }
+        else if (_shrinkEnabled && size * 4 <= capacity)
+        {
+            if (++current._smallUpdates >= ShrinkAfterUpdates)
+                capacity = size * 2;
+        }
+        else
+        {
+            current._smallUpdates = 0;
         }
 
-        if (_count == 0)
-            return;
+        if (capacity != current._capacity && current._buffer)
+        {
+            //a frame still in flight may be reading it
+            device.deletionQueue().destroyBuffer(current._buffer, current._memory);
+            current._memory = nullptr;
+            current._buffer = VK_NULL_HANDLE;
+            current._mapped = nullptr;
+            current._capacity = 0;
+            current._smallUpdates = 0;
+            ++_packetVersion;
+        }
 
+        if (capacity == 0)
+        {
+            dirty.clear();
+            return;
+        }
 
-        if (!isValid(swapChain.frame()))
+        if (!current._buffer)
         {
             //create buffer
             VkBufferCreateInfo bufferInfo{};
             bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-            bufferInfo.size = _elementSize * _count;
+            bufferInfo.size = capacity;
             bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
             bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -65,15 +120,54 @@ namespace vkl
             createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
             VmaAllocationInfo info{};
-            vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &current._buffer, &current._memory, &info);
+            if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &current._buffer, &current._memory, &info) != VK_SUCCESS) {
+                throw std::runtime_error("Error");
+            }
 
             current._mapped = info.pMappedData;
+            current._capacity = capacity;
+            ++_packetVersion;
+
+            //a fresh buffer needs everything
+            dirty.addAll();
+        }
+
+        //only the touched bytes of the live range
+        if (current._mapped && _data)
+            dirty.copy(current._mapped, _data, size);
+        else
+            dirty.clear();
+
+    }
+
+    void IndexBuffer::updateStatic(const Device& device, const SwapChain& swapChain)
+    {
+        auto& current = _buffers[0];
+
+        //earlier frames may still be drawing from the old buffer
+        if (current._buffer)
+        {
+            device.deletionQueue().destroyBuffer(current._buffer, current._memory);
+            current._buffer = VK_NULL_HANDLE;
+            current._memory = nullptr;
+            ++_packetVersion;
         }
 
-        //populate buffer
-        if (current._mapped && _data && _count)
-            memcpy(current._mapped, _data, _elementSize * _count);
+        if (_count == 0 || !_data)
+            return;
+
+        VkBuffer stagingBuffer{ VK_NULL_HANDLE };
+        VmaAllocation stagingMemory{ nullptr };
+        createDeviceLocalBuffer(device, swapChain, swapChain.frame(), _data, _elementSize * _count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, current._buffer, current._memory, stagingBuffer, stagingMemory);
+        device.deletionQueue().destroyBuffer(stagingBuffer, stagingMemory);
+        ++_packetVersion;
+    }
 
+    bool IndexBuffer::flushDirty(const Device& device, const SwapChain& swapChain)
+    {
+        update(device, swapChain);
+        return std::any_of(_dirties.begin(), _dirties.end(), [](const DirtyRanges& dirty) { return !dirty.empty(); });
     }
 
     void* IndexBuffer::data() const
@@ -91,23 +185,66 @@ namespace vkl
         return _count;
     }
 
+    VkIndexType IndexBuffer::indexType() const
+    {
+        return _elementSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+
+    BufferUsage IndexBuffer::usage() const
+    {
+        return _usage;
+    }
+
+    uint64_t IndexBuffer::packetVersion() const
+    {
+        return _packetVersion;
+    }
+
+    size_t IndexBuffer::capacity(size_t frameIndex) const
+    {
+        return _usage == BufferUsage::Static ? _elementSize * _count : _buffers[frameIndex]._capacity;
+    }
+
+    void IndexBuffer::setShrinkEnabled(bool enabled)
+    {
+        _shrinkEnabled = enabled;
+    }
+
+    bool IndexBuffer::shrinkEnabled() const
+    {
+        return _shrinkEnabled;
+    }
+
+    void IndexBuffer::setChangeDetection(bool enabled)
+    {
+        _changeDetection = enabled;
+        _contentHash.reset();
+    }
+
+    bool IndexBuffer::changeDetection() const
+    {
+        return _changeDetection;
+    }
+
     VkBuffer IndexBuffer::handle(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer;
+        return _buffers[_usage == BufferUsage::Static ? 0 : frameIndex]._buffer;
     }
 
     bool IndexBuffer::isValid(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer != VK_NULL_HANDLE;
+        return handle(frameIndex) != VK_NULL_HANDLE;
     }
     void IndexBuffer::cleanUp(const Device& device)
     {
+        //cleaned up while frames may still be drawing with it, BufferManager::cleanUnusedBuffers
         for (auto&& buffer : _buffers)
         {
-            vmaDestroyBuffer(device.allocatorHandle(), buffer._buffer, buffer._memory);
+            device.deletionQueue().destroyBuffer(buffer._buffer, buffer._memory);
             buffer._memory = nullptr;
             buffer._buffer = VK_NULL_HANDLE;
             buffer._mapped = nullptr;
+            buffer._capacity = 0;
         }
         _buffers.clear();
     }
@@ -112,7 +112,8 @@ namespace vkl
 		appInfo.applicationVersion = VKL_VULKAN_VERSION;
 		appInfo.pEngineName = VKL_ENGINE_NAME;
 		appInfo.engineVersion = VK_MAKE_VERSION(0, 0, 1);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		//1.1 for descriptor update templates
+		appInfo.apiVersion = VK_API_VERSION_1_1;
 
 		VkInstanceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
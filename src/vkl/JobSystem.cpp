@@ -0,0 +1,327 @@
+#include <vkl/JobSystem.h>
+
+#include <mutex>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#include <immintrin.h>
+#define VKL_CPU_PAUSE() _mm_pause()
+#else
+#define VKL_CPU_PAUSE() std::this_thread::yield()
+#endif
+
+namespace vkl
+{
+	namespace
+	{
+		constexpr size_t JobRingSize = 4096;
+		constexpr size_t JobQueueSize = 4096;
+		constexpr uint32_t NoQueue = ~0u;
+
+		std::mutex s_optionsMutex;
+		JobSystemOptions s_options;
+		bool s_started = false;
+
+		//jobs are recycled in submit order, a slot whose job is still unfinished is skipped
+		//when every slot is live (wide or deeply nested job trees) the ring grows by another block
+		struct JobRing
+		{
+			std::vector<std::unique_ptr<Job[]>> blocks;
+			size_t next = 0;
+
+			JobRing()
+			{
+				blocks.emplace_back(new Job[JobRingSize]);
+			}
+
+			Job* acquire()
+			{
+				size_t total = blocks.size() * JobRingSize;
+				for (size_t i = 0; i < total; ++i)
+				{
+					size_t index = next++ % total;
+					Job& job = blocks[index / JobRingSize][index % JobRingSize];
+					if (job.unfinished.load(std::memory_order_acquire) == 0)
+						return &job;
+				}
+				blocks.emplace_back(new Job[JobRingSize]);
+				next = total + 1;
+				return &blocks.back()[0];
+			}
+		};
+
+		thread_local JobRing t_jobRing;
+		thread_local uint32_t t_queueIndex = NoQueue;
+		thread_local bool t_queueAssigned = false;
+
+		void pinThread(std::thread& thread, uint32_t core)
+		{
+			unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+			core %= cores;
+#ifdef WIN32
+			SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#else
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+#endif
+		}
+	}
+
+	//Chase-Lev deque, owner pushes/pops the bottom, everyone else steals from the top
+	class JobQueue
+	{
+	public:
+		bool push(Job* job)
+		{
+			int64_t b = _bottom.load(std::memory_order_relaxed);
+			int64_t t = _top.load(std::memory_order_acquire);
+			if (b - t >= (int64_t)JobQueueSize)
+				return false;
+			_jobs[b & (JobQueueSize - 1)].store(job, std::memory_order_relaxed);
+			_bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		Job* pop()
+		{
+			int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+			_bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = _top.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				_bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* job = _jobs[b & (JobQueueSize - 1)].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				//last one, race the stealers for it
+				if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = nullptr;
+				_bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* steal()
+		{
+			int64_t t = _top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = _bottom.load(std::memory_order_acquire);
+
+			if (t >= b)
+				return nullptr;
+
+			Job* job = _jobs[t & (JobQueueSize - 1)].load(std::memory_order_relaxed);
+			if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return job;
+		}
+
+	private:
+		alignas(64) std::atomic<int64_t> _top{ 0 };
+		alignas(64) std::atomic<int64_t> _bottom{ 0 };
+		alignas(64) std::atomic<Job*> _jobs[JobQueueSize];
+	};
+
+	bool JobSystem::configure(const JobSystemOptions& options)
+	{
+		std::unique_lock<std::mutex> lock(s_optionsMutex);
+		if (s_started)
+			return false;
+		s_options = options;
+		return true;
+	}
+
+	JobSystem& JobSystem::instance()
+	{
+		static JobSystem system([]() {
+			std::unique_lock<std::mutex> lock(s_optionsMutex);
+			s_started = true;
+			return s_options;
+			}());
+		return system;
+	}
+
+	JobSystem::JobSystem(const JobSystemOptions& options)
+		: _options(options)
+	{
+		size_t workerCount = 0;
+		if (_options.workerCount < 0)
+			workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+		else
+			workerCount = (size_t)_options.workerCount;
+
+		for (size_t i = 0; i < workerCount + _options.externalThreadSlots; ++i)
+			_queues.emplace_back(std::make_unique<JobQueue>());
+
+		for (size_t i = 0; i < workerCount; ++i)
+		{
+			_workers.emplace_back([this, i]() { workerLoop(i); });
+			if (_options.pinWorkers)
+				pinThread(_workers.back(), _options.firstCore + (uint32_t)i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		_running.store(false);
+		_wakeEpoch.fetch_add(1);
+		_wakeEpoch.notify_all();
+		for (auto&& worker : _workers)
+			worker.join();
+	}
+
+	Job* JobSystem::createJob(JobFunction function, Job* parent)
+	{
+		Job* job = t_jobRing.acquire();
+		job->function = function;
+		job->parent = parent;
+		job->unfinished.store(1, std::memory_order_relaxed);
+		if (parent)
+			parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	void JobSystem::run(Job* job)
+	{
+		JobQueue* queue = queueForThisThread();
+		if (!queue || !queue->push(job))
+		{
+			//no deque for this thread or it is full, just do it here
+			execute(job);
+			return;
+		}
+		wakeWorker();
+	}
+
+	void JobSystem::wait(const Job* job)
+	{
+		JobQueue* queue = queueForThisThread();
+		while (!isComplete(job))
+		{
+			if (Job* next = getJob(queue))
+				execute(next);
+			else
+				VKL_CPU_PAUSE();
+		}
+	}
+
+	bool JobSystem::isComplete(const Job* job) const
+	{
+		return job->unfinished.load(std::memory_order_acquire) == 0;
+	}
+
+	void JobSystem::execute(Job* job)
+	{
+		job->function(*job);
+		finish(job);
+	}
+
+	void JobSystem::finish(Job* job)
+	{
+		//the slot can be reused as soon as the count hits 0, read parent before
+		Job* parent = job->parent;
+		if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent)
+			finish(parent);
+	}
+
+	Job* JobSystem::getJob(JobQueue* ownQueue)
+	{
+		if (ownQueue)
+		{
+			if (Job* job = ownQueue->pop())
+				return job;
+		}
+
+		//start stealing next to ourselves so thieves spread out over the victims
+		size_t queueCount = _queues.size();
+		size_t start = t_queueIndex == NoQueue ? 0 : t_queueIndex + 1;
+		for (size_t i = 0; i < queueCount; ++i)
+		{
+			JobQueue* victim = _queues[(start + i) % queueCount].get();
+			if (victim == ownQueue)
+				continue;
+			if (Job* job = victim->steal())
+				return job;
+		}
+		return nullptr;
+	}
+
+	JobQueue* JobSystem::queueForThisThread()
+	{
+		if (!t_queueAssigned)
+		{
+			t_queueAssigned = true;
+			uint32_t slot = _nextExternalSlot.fetch_add(1);
+			if (slot < _options.externalThreadSlots)
+				t_queueIndex = (uint32_t)_workers.size() + slot;
+		}
+		return t_queueIndex == NoQueue ? nullptr : _queues[t_queueIndex].get();
+	}
+
+	size_t JobSystem::threadIndex()
+	{
+		queueForThisThread();
+		return t_queueIndex == NoQueue ? _queues.size() : t_queueIndex;
+	}
+
+	void JobSystem::workerLoop(size_t index)
+	{
+		t_queueAssigned = true;
+		t_queueIndex = (uint32_t)index;
+		JobQueue* queue = _queues[index].get();
+
+		uint32_t spins = 0;
+		while (_running.load(std::memory_order_relaxed))
+		{
+			if (Job* job = getJob(queue))
+			{
+				execute(job);
+				spins = 0;
+				continue;
+			}
+
+			if (spins++ < _options.spinCount)
+			{
+				VKL_CPU_PAUSE();
+				continue;
+			}
+
+			//grab the epoch before the last look so a push in between can't be missed
+			uint32_t epoch = _wakeEpoch.load(std::memory_order_acquire);
+			_sleepers.fetch_add(1, std::memory_order_seq_cst);
+			if (Job* job = getJob(queue))
+			{
+				_sleepers.fetch_sub(1, std::memory_order_relaxed);
+				execute(job);
+				spins = 0;
+				continue;
+			}
+			if (_running.load(std::memory_order_relaxed))
+				_wakeEpoch.wait(epoch, std::memory_order_acquire);
+			_sleepers.fetch_sub(1, std::memory_order_relaxed);
+			spins = 0;
+		}
+	}
+
+	void JobSystem::wakeWorker()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_sleepers.load(std::memory_order_relaxed) == 0)
+			return;
+		_wakeEpoch.fetch_add(1, std::memory_order_release);
+		_wakeEpoch.notify_one();
+	}
+}
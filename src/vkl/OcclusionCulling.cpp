@@ -0,0 +1,629 @@
+#include <vkl/OcclusionCulling.h>
+
+#include <vkl/Device.h>
+#include <vkl/SwapChain.h>
+#include <vkl/Shader.h>
+#include <vkl/DescriptorAllocator.h>
+#include <vkl/DeletionQueue.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace vkl
+{
+	namespace
+	{
+		constexpr uint32_t ReduceGroupSize = 8;
+		constexpr uint32_t TestGroupSize = 64;
+
+		//level 0 takes the max over every depth texel (and sample) it covers, every other level the max of 2x2 of the one above
+		constexpr const char* ReduceShader = R"Shader(
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+#ifdef MULTISAMPLED
+layout(binding = 0) uniform sampler2DMS u_depth;
+#else
+layout(binding = 0) uniform sampler2D u_depth;
+#endif
+layout(binding = 1, r32f) uniform readonly image2D u_source;
+layout(binding = 2, r32f) uniform writeonly image2D u_target;
+
+layout(push_constant) uniform Reduce {
+	ivec2 targetSize;
+	ivec2 sourceSize;
+	int samples;
+	int fromDepth;
+} u_reduce;
+
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(texel, u_reduce.targetSize)))
+		return;
+
+	float depth = 0.0;
+	if(u_reduce.fromDepth != 0)
+	{
+		//the chain is a power of two, the depth image usually isn't
+		ivec2 begin = texel * u_reduce.sourceSize / u_reduce.targetSize;
+		ivec2 end = min(((texel + 1) * u_reduce.sourceSize + u_reduce.targetSize - 1) / u_reduce.targetSize, u_reduce.sourceSize);
+		for(int y = begin.y; y < end.y; ++y)
+		{
+			for(int x = begin.x; x < end.x; ++x)
+			{
+#ifdef MULTISAMPLED
+				for(int s = 0; s < u_reduce.samples; ++s)
+					depth = max(depth, texelFetch(u_depth, ivec2(x, y), s).r);
+#else
+				depth = max(depth, texelFetch(u_depth, ivec2(x, y), 0).r);
+#endif
+			}
+		}
+	}
+	else
+	{
+		ivec2 source = texel * 2;
+		ivec2 last = u_reduce.sourceSize - 1;
+		depth = max(max(imageLoad(u_source, min(source, last)).r, imageLoad(u_source, min(source + ivec2(1, 0), last)).r),
+			max(imageLoad(u_source, min(source + ivec2(0, 1), last)).r, imageLoad(u_source, min(source + ivec2(1, 1), last)).r));
+	}
+	imageStore(u_target, texel, vec4(depth));
+}
+
+)Shader";
+
+		//box around the sphere projected to a screen rect, tested at the level where the rect covers at most 2x2 texels
+		constexpr const char* TestShader = R"Shader(
+
+#version 450
+
+layout(local_size_x = 64) in;
+
+layout(binding = 0) uniform sampler2D u_hiZ;
+layout(std430, binding = 1) readonly buffer Spheres { vec4 spheres[]; };
+layout(std430, binding = 2) writeonly buffer Visibility { uint visibility[]; };
+
+layout(push_constant) uniform Test {
+	mat4 viewProjection;
+	vec2 hiZSize;
+	uint levels;
+	uint count;
+} u_test;
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	if(index >= u_test.count)
+		return;
+
+	vec4 sphere = spheres[index];
+	vec3 ndcMin = vec3(1e30);
+	vec3 ndcMax = vec3(-1e30);
+	for(int i = 0; i < 8; ++i)
+	{
+		vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = u_test.viewProjection * vec4(corner, 1.0);
+		//reaches behind the camera, nothing to test against
+		if(clip.w <= 0.0)
+		{
+			visibility[index] = 1u;
+			return;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+
+	vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 size = (uvMax - uvMin) * u_test.hiZSize;
+	int level = int(clamp(ceil(log2(max(max(size.x, size.y), 1.0))), 0.0, float(u_test.levels - 1)));
+
+	ivec2 levelSize = textureSize(u_hiZ, level);
+	ivec2 texelMin = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+	ivec2 texelMax = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+	float depth = max(max(texelFetch(u_hiZ, texelMin, level).r, texelFetch(u_hiZ, ivec2(texelMax.x, texelMin.y), level).r),
+		max(texelFetch(u_hiZ, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(u_hiZ, texelMax, level).r));
+
+	visibility[index] = ndcMin.z <= depth ? 1u : 0u;
+}
+
+)Shader";
+
+		struct ReduceConstants
+		{
+			int32_t targetSize[2];
+			int32_t sourceSize[2];
+			int32_t samples;
+			int32_t fromDepth;
+		};
+
+		struct TestConstants
+		{
+			float viewProjection[16];
+			float hiZSize[2];
+			uint32_t levels;
+			uint32_t count;
+		};
+
+		uint32_t floorPow2(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result * 2 <= value)
+				result *= 2;
+			return result;
+		}
+
+		uint32_t groupCount(uint32_t count, uint32_t groupSize)
+		{
+			return (count + groupSize - 1) / groupSize;
+		}
+
+		void computeBarrier(VkCommandBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(buffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		VkDescriptorSetLayout createSetLayout(const Device& device, std::span<const VkDescriptorType> types)
+		{
+			std::vector<VkDescriptorSetLayoutBinding> bindings(types.size());
+			for (uint32_t i = 0; i < bindings.size(); ++i)
+			{
+				bindings[i].binding = i;
+				bindings[i].descriptorCount = 1;
+				bindings[i].descriptorType = types[i];
+				bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			}
+
+			VkDescriptorSetLayoutCreateInfo layoutInfo{};
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			layoutInfo.bindingCount = (uint32_t)bindings.size();
+			layoutInfo.pBindings = bindings.data();
+
+			VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+			if (vkCreateDescriptorSetLayout(device.handle(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			return layout;
+		}
+
+		VkPipelineLayout createPipelineLayout(const Device& device, VkDescriptorSetLayout setLayout, uint32_t pushConstantSize)
+		{
+			VkPushConstantRange pushConstantRange{};
+			pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			pushConstantRange.offset = 0;
+			pushConstantRange.size = pushConstantSize;
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &setLayout;
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			if (vkCreatePipelineLayout(device.handle(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			return layout;
+		}
+
+		VkPipeline createComputePipeline(const Device& device, VkPipelineLayout layout, const char* source)
+		{
+			ShaderModule shaderModule(device, std::make_shared<GLSLShader>(source, VK_SHADER_STAGE_COMPUTE_BIT), VK_SHADER_STAGE_COMPUTE_BIT);
+
+			VkComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = shaderModule.handle();
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = layout;
+
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			VkResult result = vkCreateComputePipelines(device.handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+			vkDestroyShaderModule(device.handle(), shaderModule.handle(), nullptr);
+			if (result != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			return pipeline;
+		}
+	}
+
+	OcclusionCuller::OcclusionCuller(const Device& device, const SwapChain& swapChain)
+	{
+		if (!device.cmdBeginConditionalRendering() || !swapChain.depthSampled())
+		{
+			throw std::runtime_error("Error");
+		}
+
+		_samples = (uint32_t)device.maxUsableSamples();
+		_depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (swapChain.depthFormat() == VK_FORMAT_D32_SFLOAT_S8_UINT || swapChain.depthFormat() == VK_FORMAT_D24_UNORM_S8_UINT)
+			_depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		_frames.resize(swapChain.framesInFlight());
+
+		createPipelines(device);
+	}
+
+	void OcclusionCuller::createPipelines(const Device& device)
+	{
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		if (vkCreateSampler(device.handle(), &samplerInfo, nullptr, &_sampler) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+
+		std::array<VkDescriptorType, 3> reduceTypes = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE };
+		std::array<VkDescriptorType, 3> testTypes = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+		_reduceSetLayout = createSetLayout(device, reduceTypes);
+		_testSetLayout = createSetLayout(device, testTypes);
+		_reduceLayout = createPipelineLayout(device, _reduceSetLayout, sizeof(ReduceConstants));
+		_testLayout = createPipelineLayout(device, _testSetLayout, sizeof(TestConstants));
+
+		//multisampled depth is read sample by sample
+		std::string reduceSource = "#version 450\n";
+		if (_samples > 1)
+			reduceSource += "#define MULTISAMPLED\n";
+		reduceSource += ReduceShader;
+
+		_reducePipeline = createComputePipeline(device, _reduceLayout, reduceSource.c_str());
+		_testPipeline = createComputePipeline(device, _testLayout, TestShader);
+	}
+
+	void OcclusionCuller::setViewProjection(const float viewProjection[16])
+	{
+		memcpy(_viewProjection, viewProjection, sizeof(_viewProjection));
+	}
+
+	void OcclusionCuller::setSpheres(std::span<const std::array<float, 4>> spheres)
+	{
+		_spheres.assign(spheres.begin(), spheres.end());
+	}
+
+	uint32_t OcclusionCuller::sphereCount() const
+	{
+		return (uint32_t)_spheres.size();
+	}
+
+	void OcclusionCuller::createHiZ(const Device& device, const SwapChain& swapChain)
+	{
+		destroyHiZ(device);
+
+		_depthImage = swapChain.depthImage();
+		_depthView = swapChain.depthImageView();
+		_depthExtent = swapChain.swapChainExtent();
+
+		//power of two so every level below the first is an exact 2x2 reduction
+		_hiZExtent.width = floorPow2(std::max(_depthExtent.width, 1u));
+		_hiZExtent.height = floorPow2(std::max(_depthExtent.height, 1u));
+		uint32_t levels = 1;
+		while ((std::max(_hiZExtent.width, _hiZExtent.height) >> levels) > 0)
+			++levels;
+
+		createImage(device, _hiZExtent.width, _hiZExtent.height, levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _hiZ, _hiZMemory);
+		_hiZView = createImageView(device, _hiZ, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, levels);
+
+		_levelViews.resize(levels);
+		for (uint32_t level = 0; level < levels; ++level)
+		{
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = _hiZ;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = VK_FORMAT_R32_SFLOAT;
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(device.handle(), &viewInfo, nullptr, &_levelViews[level]) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+		}
+
+		std::array<VkDescriptorPoolSize, 2> poolSizes{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = 1;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = 2;
+		_reduceSets.resize(levels);
+		device.descriptorAllocator().allocate(device, _reduceSetLayout, poolSizes, _reduceSets);
+
+		//every binding is written for every level, level 0 never reads its source
+		for (uint32_t level = 0; level < levels; ++level)
+		{
+			std::array<VkDescriptorImageInfo, 3> imageInfos{};
+			imageInfos[0].sampler = _sampler;
+			imageInfos[0].imageView = _depthView;
+			imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			imageInfos[1].imageView = _levelViews[level == 0 ? 0 : level - 1];
+			imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			imageInfos[2].imageView = _levelViews[level];
+			imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			std::array<VkWriteDescriptorSet, 3> writes{};
+			for (uint32_t i = 0; i < writes.size(); ++i)
+			{
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = _reduceSets[level];
+				writes[i].dstBinding = i;
+				writes[i].dstArrayElement = 0;
+				writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				writes[i].descriptorCount = 1;
+				writes[i].pImageInfo = &imageInfos[i];
+			}
+			vkUpdateDescriptorSets(device.handle(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+		}
+
+		++_hiZVersion;
+	}
+
+	void OcclusionCuller::destroyHiZ(const Device& device)
+	{
+		if (!_reduceSets.empty())
+			device.descriptorAllocator().free(_reduceSetLayout, _reduceSets);
+		_reduceSets.clear();
+
+		for (auto&& view : _levelViews)
+			vkDestroyImageView(device.handle(), view, nullptr);
+		_levelViews.clear();
+
+		if (_hiZView != VK_NULL_HANDLE)
+			vkDestroyImageView(device.handle(), _hiZView, nullptr);
+		if (_hiZ != VK_NULL_HANDLE)
+			vmaDestroyImage(device.allocatorHandle(), _hiZ, _hiZMemory);
+		_hiZView = VK_NULL_HANDLE;
+		_hiZ = VK_NULL_HANDLE;
+		_hiZMemory = nullptr;
+
+		_depthImage = VK_NULL_HANDLE;
+		_depthView = VK_NULL_HANDLE;
+	}
+
+	void OcclusionCuller::update(const Device& device, const SwapChain& swapChain)
+	{
+		//the swap chain waits for the device to go idle before it recreates its depth image
+		VkExtent2D extent = swapChain.swapChainExtent();
+		if (_depthView != swapChain.depthImageView() || _depthExtent.width != extent.width || _depthExtent.height != extent.height)
+			createHiZ(device, swapChain);
+
+		FrameData& data = _frames[swapChain.frame()];
+
+		//only grows, the old buffer goes once every frame that may still read it has finished
+		auto reserve = [&](Allocation& allocation, size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+			size = std::max<size_t>(size, 16);
+			if (allocation.buffer && allocation.size >= size)
+				return false;
+
+			if (allocation.buffer)
+				device.deletionQueue().destroyBuffer(allocation.buffer, allocation.memory);
+			allocation = {};
+
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = size;
+			bufferInfo.usage = usage;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VmaAllocationCreateInfo createAllocation{};
+			createAllocation.usage = memoryUsage;
+			createAllocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+			VmaAllocationInfo info{};
+			if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &allocation.buffer, &allocation.memory, &info) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			allocation.mapped = info.pMappedData;
+			allocation.size = size;
+			return true;
+		};
+
+		bool recreated = false;
+		recreated |= reserve(data.spheres, _spheres.size() * sizeof(_spheres[0]), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+		//read by conditional rendering this frame and by the cpu once the frame is done
+		recreated |= reserve(data.visibility, _spheres.size() * PredicateStride, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+		if (!_spheres.empty())
+			memcpy(data.spheres.mapped, _spheres.data(), _spheres.size() * sizeof(_spheres[0]));
+		data.count = (uint32_t)_spheres.size();
+
+		if (!recreated && data.hiZVersion == _hiZVersion)
+			return;
+		data.hiZVersion = _hiZVersion;
+
+		if (!data.set)
+		{
+			std::array<VkDescriptorPoolSize, 2> poolSizes{};
+			poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			poolSizes[0].descriptorCount = 1;
+			poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			poolSizes[1].descriptorCount = 2;
+			device.descriptorAllocator().allocate(device, _testSetLayout, poolSizes, std::span<VkDescriptorSet>(&data.set, 1));
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = _sampler;
+		imageInfo.imageView = _hiZView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+		bufferInfos[0].buffer = data.spheres.buffer;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = data.visibility.buffer;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 3> writes{};
+		for (uint32_t i = 0; i < writes.size(); ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = data.set;
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorCount = 1;
+		}
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pBufferInfo = &bufferInfos[0];
+		writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[2].pBufferInfo = &bufferInfos[1];
+		vkUpdateDescriptorSets(device.handle(), (uint32_t)writes.size(), writes.data(), 0, nullptr);
+	}
+
+	void OcclusionCuller::recordBuild(VkCommandBuffer buffer, size_t frame) const
+	{
+		const FrameData& data = _frames[frame];
+
+		//depth becomes readable, the chain is rewritten from scratch once the last frame's reads are done
+		std::array<VkImageMemoryBarrier, 2> barriers{};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = _depthImage;
+		barriers[0].subresourceRange.aspectMask = _depthAspect;
+		barriers[0].subresourceRange.levelCount = 1;
+		barriers[0].subresourceRange.layerCount = 1;
+
+		barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].image = _hiZ;
+		barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barriers[1].subresourceRange.levelCount = (uint32_t)_levelViews.size();
+		barriers[1].subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+		//nothing to test, depth still has to end up where the resume pass expects it
+		if (data.count == 0 || !data.set)
+			return;
+
+		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _reducePipeline);
+
+		ReduceConstants reduce{};
+		reduce.samples = (int32_t)_samples;
+		for (uint32_t level = 0; level < _levelViews.size(); ++level)
+		{
+			reduce.targetSize[0] = (int32_t)std::max(_hiZExtent.width >> level, 1u);
+			reduce.targetSize[1] = (int32_t)std::max(_hiZExtent.height >> level, 1u);
+			reduce.sourceSize[0] = level == 0 ? (int32_t)_depthExtent.width : (int32_t)std::max(_hiZExtent.width >> (level - 1), 1u);
+			reduce.sourceSize[1] = level == 0 ? (int32_t)_depthExtent.height : (int32_t)std::max(_hiZExtent.height >> (level - 1), 1u);
+			reduce.fromDepth = level == 0 ? 1 : 0;
+
+			vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _reduceLayout, 0, 1, &_reduceSets[level], 0, nullptr);
+			vkCmdPushConstants(buffer, _reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants), &reduce);
+			vkCmdDispatch(buffer, groupCount((uint32_t)reduce.targetSize[0], ReduceGroupSize), groupCount((uint32_t)reduce.targetSize[1], ReduceGroupSize), 1);
+
+			computeBarrier(buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		}
+
+		TestConstants test{};
+		memcpy(test.viewProjection, _viewProjection, sizeof(test.viewProjection));
+		test.hiZSize[0] = (float)_hiZExtent.width;
+		test.hiZSize[1] = (float)_hiZExtent.height;
+		test.levels = (uint32_t)_levelViews.size();
+		test.count = data.count;
+
+		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _testPipeline);
+		vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _testLayout, 0, 1, &data.set, 0, nullptr);
+		vkCmdPushConstants(buffer, _testLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TestConstants), &test);
+		vkCmdDispatch(buffer, groupCount(data.count, TestGroupSize), 1, 1);
+
+		computeBarrier(buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT | VK_ACCESS_HOST_READ_BIT);
+	}
+
+	VkBuffer OcclusionCuller::predicateBuffer(size_t frame) const
+	{
+		return _frames[frame].visibility.buffer;
+	}
+
+	std::span<const uint32_t> OcclusionCuller::results(size_t frame) const
+	{
+		const FrameData& data = _frames[frame];
+		if (!data.visibility.mapped)
+			return {};
+		return std::span<const uint32_t>((const uint32_t*)data.visibility.mapped, data.count);
+	}
+
+	VkExtent2D OcclusionCuller::hiZExtent() const
+	{
+		return _hiZExtent;
+	}
+
+	uint32_t OcclusionCuller::hiZLevels() const
+	{
+		return (uint32_t)_levelViews.size();
+	}
+
+	void OcclusionCuller::cleanUp(const Device& device)
+	{
+		destroyHiZ(device);
+
+		for (auto&& data : _frames)
+		{
+			for (Allocation* allocation : { &data.spheres, &data.visibility })
+			{
+				if (allocation->buffer)
+					device.deletionQueue().destroyBuffer(allocation->buffer, allocation->memory);
+				*allocation = {};
+			}
+			data.set = VK_NULL_HANDLE;
+			data.count = 0;
+			data.hiZVersion = 0;
+		}
+
+		if (_reducePipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(device.handle(), _reducePipeline, nullptr);
+		if (_testPipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(device.handle(), _testPipeline, nullptr);
+		if (_reduceLayout != VK_NULL_HANDLE)
+			vkDestroyPipelineLayout(device.handle(), _reduceLayout, nullptr);
+		if (_testLayout != VK_NULL_HANDLE)
+			vkDestroyPipelineLayout(device.handle(), _testLayout, nullptr);
+		//the sets go with the layouts' pools
+		for (VkDescriptorSetLayout layout : { _reduceSetLayout, _testSetLayout })
+		{
+			if (layout == VK_NULL_HANDLE)
+				continue;
+			device.descriptorAllocator().releaseLayout(device, layout);
+			vkDestroyDescriptorSetLayout(device.handle(), layout, nullptr);
+		}
+		if (_sampler != VK_NULL_HANDLE)
+			vkDestroySampler(device.handle(), _sampler, nullptr);
+		_reducePipeline = VK_NULL_HANDLE;
+		_testPipeline = VK_NULL_HANDLE;
+		_reduceLayout = VK_NULL_HANDLE;
+		_testLayout = VK_NULL_HANDLE;
+		_reduceSetLayout = VK_NULL_HANDLE;
+		_testSetLayout = VK_NULL_HANDLE;
+		_sampler = VK_NULL_HANDLE;
+	}
+}
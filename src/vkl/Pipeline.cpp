@@ -5,6 +5,8 @@
 #include <vkl/Device.h>
 #include <vkl/RenderPass.h>
 #include <vkl/SwapChain.h>
+#include <vkl/BindlessTextures.h>
+#include <vkl/DescriptorAllocator.h>
 
 #include <array>
 
@@ -156,9 +158,9 @@ namespace vkl
 		_shaders.push_back({ .stage = stage, .shader = shaderData });
 	}
 
-	void PipelineDescription::declareVertexAttribute(uint32_t binding, uint32_t location, VkFormat format, size_t bindingSize, size_t locationOffset)
+	void PipelineDescription::declareVertexAttribute(uint32_t binding, uint32_t location, VkFormat format, size_t bindingSize, size_t locationOffset, VkVertexInputRate inputRate)
 	{
-		_attributes.push_back({ .binding = binding, .location = location, .format = format, .size = bindingSize, .offset = locationOffset });
+		_attributes.push_back({ .binding = binding, .location = location, .format = format, .size = bindingSize, .offset = locationOffset, .inputRate = inputRate });
 	}
 
 	void PipelineDescription::declareUniform(uint32_t binding, size_t size)
@@ -216,6 +218,46 @@ namespace vkl
 		_blend = enable;
 	}
 
+	bool PipelineDescription::depthPrePass() const
+	{
+		return _depthPrePass;
+	}
+
+	void PipelineDescription::setDepthPrePass(bool prePass)
+	{
+		_depthPrePass = prePass;
+	}
+
+	bool PipelineDescription::alphaVariants() const
+	{
+		return _alphaVariants;
+	}
+
+	void PipelineDescription::setAlphaVariants(bool alphaVariants)
+	{
+		_alphaVariants = alphaVariants;
+	}
+
+	bool PipelineDescription::pushDescriptors() const
+	{
+		return _pushDescriptors;
+	}
+
+	void PipelineDescription::setPushDescriptors(bool push)
+	{
+		_pushDescriptors = push;
+	}
+
+	bool PipelineDescription::bindlessTextures() const
+	{
+		return _bindlessTextures;
+	}
+
+	void PipelineDescription::setBindlessTextures(bool bindless)
+	{
+		_bindlessTextures = bindless;
+	}
+
 	std::span<const PipelineDescription::ShaderDescription> PipelineDescription::shaders() const
 	{
 		return _shaders;
@@ -245,8 +287,14 @@ namespace vkl
 
 	Pipeline::Pipeline(const Device& device, const SwapChain& swapChain, const PipelineDescription& description, const RenderPass& renderPass, std::type_index typeIndex) : _type(typeIndex)
 	{
+		size_t bindingCount = description.uniforms().size() + description.textures().size();
+		if (description.pushDescriptors() && device.pushDescriptorsSupported() && bindingCount > 0 && bindingCount <= device.maxPushDescriptors())
+			_cmdPushDescriptorSetWithTemplate = device.cmdPushDescriptorSetWithTemplate();
+		_dynamicUniforms = !usesPushDescriptors() && !description.uniforms().empty() && description.uniforms().size() <= device.maxDynamicUniformBuffers();
+
 		createDescriptorSetLayout(device, swapChain, description, renderPass);
 		createPipeline(device, swapChain, description, renderPass);
+		createDescriptorTemplate(device, description);
 	}
 
 	void Pipeline::createDescriptorSetLayout(const Device& device, const SwapChain& swapChain, const PipelineDescription& description, const RenderPass& renderPass)
@@ -258,7 +306,7 @@ namespace vkl
 			VkDescriptorSetLayoutBinding uboLayoutBinding{};
 			uboLayoutBinding.binding = uniform.binding;
 			uboLayoutBinding.descriptorCount = 1;
-			uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			uboLayoutBinding.descriptorType = uniformDescriptorType();
 			uboLayoutBinding.pImmutableSamplers = nullptr;
 			uboLayoutBinding.stageFlags = VK_SHADER_STAGE_ALL;
 			layoutBindings.push_back(uboLayoutBinding);
@@ -278,11 +326,23 @@ namespace vkl
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
 		layoutInfo.pBindings = layoutBindings.data();
+		if (usesPushDescriptors())
+			layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
 
 		if (vkCreateDescriptorSetLayout(device.handle(), &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
 			throw std::runtime_error("Error");
 		}
 
+		if (description.bindlessTextures())
+		{
+			//the table was sized leaving only this much of the per stage limits to set 0
+			if (!device.bindlessSupported() || description.textures().size() > BindlessReservedTextures)
+			{
+				throw std::runtime_error("Error");
+			}
+			_bindlessSetLayout = BindlessTextureTable::createSetLayout(device);
+		}
+
 	}
 
 	void Pipeline::createPipeline(const Device& device, const SwapChain& swapChain, const PipelineDescription& description, const RenderPass& renderPass)
@@ -325,9 +385,11 @@ namespace vkl
 				VkVertexInputBindingDescription bindingDescription{};
 				bindingDescription.binding = vbo.binding;
 				bindingDescription.stride = (uint32_t)vbo.size;
-				bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+				bindingDescription.inputRate = vbo.inputRate;
 				bindingDescriptions.emplace_back(std::move(bindingDescription));
 			}
+			else if (findBinding->inputRate != vbo.inputRate)
+				throw std::runtime_error("Error");
 
 			VkVertexInputAttributeDescription attributeDesc{};
 			attributeDesc.binding = vbo.binding;
@@ -365,11 +427,15 @@ namespace vkl
 		multisampling.sampleShadingEnable = VK_FALSE;
 		multisampling.rasterizationSamples = device.maxUsableSamples();
 
+		//depth is already final after the pre-pass, only the front most surface passes
+		bool prePass = renderPass.options().depthPrePass && description.depthPrePass() && description.depthEnabled() && !description.blendEnabled();
+		bool alphaVariants = description.alphaVariants() && !description.blendEnabled();
+
 		VkPipelineDepthStencilStateCreateInfo depthStencil{};
 		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 		depthStencil.depthTestEnable = description.depthEnabled();
-		depthStencil.depthWriteEnable = VK_TRUE;
-		depthStencil.depthCompareOp = description.depthOp();
+		depthStencil.depthWriteEnable = prePass ? VK_FALSE : VK_TRUE;
+		depthStencil.depthCompareOp = prePass ? VK_COMPARE_OP_EQUAL : description.depthOp();
 		depthStencil.depthBoundsTestEnable = VK_FALSE;
 		depthStencil.stencilTestEnable = VK_FALSE;
 
@@ -424,8 +490,9 @@ namespace vkl
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
-		pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { _descriptorSetLayout, _bindlessSetLayout };
+		pipelineLayoutInfo.setLayoutCount = usesBindlessTextures() ? 2 : 1;
+		pipelineLayoutInfo.pSetLayouts = setLayouts.data();
 
 		VkPushConstantRange pushConstantRange{};
 		if (description.pushConstant().hasPushConstant)
@@ -462,12 +529,139 @@ namespace vkl
 			throw std::runtime_error("Error");
 		}
 
+		auto createVariant = [&](VkPipeline& variant) {
+			if (vkCreateGraphicsPipelines(device.handle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &variant) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+		};
+
+		//RenderQueue::Blend, over whatever is already there without writing depth
+		if (alphaVariants)
+		{
+			depthStencil.depthWriteEnable = VK_FALSE;
+			depthStencil.depthCompareOp = description.depthOp();
+			colorBlendAttachment.blendEnable = VK_TRUE;
+			createVariant(_blendPipeline);
+		}
+
+		if (prePass)
+		{
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = description.depthOp();
+			colorBlendAttachment.blendEnable = VK_FALSE;
+			colorBlendAttachment.colorWriteMask = 0;
+
+			//RenderQueue::Mask keeps the fragment stage so discarded pixels stay out of the depth buffer
+			if (alphaVariants)
+				createVariant(_maskDepthOnlyPipeline);
+
+			std::vector<VkPipelineShaderStageCreateInfo> depthStages;
+			for (auto&& stage : shaderStageCreateInfos)
+			{
+				if (stage.stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+					depthStages.push_back(stage);
+			}
+			pipelineInfo.stageCount = static_cast<uint32_t>(depthStages.size());
+			pipelineInfo.pStages = depthStages.data();
+			createVariant(_depthOnlyPipeline);
+		}
+
 		for (auto&& shaderMod : shaderModules)
 			vkDestroyShaderModule(device.handle(), shaderMod.handle(), nullptr);
 
 
 	}
 
+	void Pipeline::createDescriptorTemplate(const Device& device, const PipelineDescription& description)
+	{
+		std::vector<VkDescriptorUpdateTemplateEntry> entries;
+		size_t offset = 0;
+		for (auto&& uniform : description.uniforms())
+		{
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = uniform.binding;
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = 1;
+			entry.descriptorType = uniformDescriptorType();
+			entry.offset = offset;
+			entry.stride = sizeof(VkDescriptorBufferInfo);
+			entries.push_back(entry);
+			offset += sizeof(VkDescriptorBufferInfo);
+		}
+		for (auto&& texture : description.textures())
+		{
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = texture.binding;
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = 1;
+			entry.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			entry.offset = offset;
+			entry.stride = sizeof(VkDescriptorImageInfo);
+			entries.push_back(entry);
+			offset += sizeof(VkDescriptorImageInfo);
+		}
+		_descriptorDataSize = offset;
+
+		if (entries.empty())
+			return;
+
+		VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+		templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+		templateInfo.pDescriptorUpdateEntries = entries.data();
+		templateInfo.descriptorSetLayout = _descriptorSetLayout;
+		if (usesPushDescriptors())
+		{
+			templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+			templateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			templateInfo.pipelineLayout = _pipelineLayout;
+			templateInfo.set = 0;
+		}
+		else
+		{
+			templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		}
+
+		if (vkCreateDescriptorUpdateTemplate(device.handle(), &templateInfo, nullptr, &_descriptorTemplate) != VK_SUCCESS) {
+			throw std::runtime_error("Error");
+		}
+	}
+
+	VkDescriptorUpdateTemplate Pipeline::descriptorTemplateHandle() const
+	{
+		return _descriptorTemplate;
+	}
+
+	size_t Pipeline::descriptorDataSize() const
+	{
+		return _descriptorDataSize;
+	}
+
+	bool Pipeline::usesPushDescriptors() const
+	{
+		return _cmdPushDescriptorSetWithTemplate != nullptr;
+	}
+
+	PFN_vkCmdPushDescriptorSetWithTemplateKHR Pipeline::cmdPushDescriptorSetWithTemplate() const
+	{
+		return _cmdPushDescriptorSetWithTemplate;
+	}
+
+	bool Pipeline::usesDynamicUniforms() const
+	{
+		return _dynamicUniforms;
+	}
+
+	VkDescriptorType Pipeline::uniformDescriptorType() const
+	{
+		return _dynamicUniforms ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	}
+
+	bool Pipeline::usesBindlessTextures() const
+	{
+		return _bindlessSetLayout != VK_NULL_HANDLE;
+	}
+
 	VkDescriptorSetLayout Pipeline::descriptorSetLayoutHandle() const
 	{
 		return _descriptorSetLayout;
@@ -478,6 +672,21 @@ namespace vkl
 		return _pipeline;
 	}
 
+	VkPipeline Pipeline::depthOnlyHandle() const
+	{
+		return _depthOnlyPipeline;
+	}
+
+	VkPipeline Pipeline::maskDepthOnlyHandle() const
+	{
+		return _maskDepthOnlyPipeline;
+	}
+
+	VkPipeline Pipeline::blendHandle() const
+	{
+		return _blendPipeline;
+	}
+
 	std::type_index Pipeline::type() const
 	{
 		return _type;
@@ -489,8 +698,19 @@ namespace vkl
 
 	void Pipeline::cleanUp(const Device& device)
 	{
+		if (_descriptorTemplate != VK_NULL_HANDLE)
+			vkDestroyDescriptorUpdateTemplate(device.handle(), _descriptorTemplate, nullptr);
 		vkDestroyPipeline(device.handle(), _pipeline, nullptr);
+		for (VkPipeline variant : { _depthOnlyPipeline, _maskDepthOnlyPipeline, _blendPipeline })
+		{
+			if (variant != VK_NULL_HANDLE)
+				vkDestroyPipeline(device.handle(), variant, nullptr);
+		}
 		vkDestroyPipelineLayout(device.handle(), _pipelineLayout, nullptr);
+		//objects' sets of this layout go with its pools, a later layout may reuse the handle
+		device.descriptorAllocator().releaseLayout(device, _descriptorSetLayout);
 		vkDestroyDescriptorSetLayout(device.handle(), _descriptorSetLayout, nullptr);
+		if (_bindlessSetLayout != VK_NULL_HANDLE)
+			vkDestroyDescriptorSetLayout(device.handle(), _bindlessSetLayout, nullptr);
 	}
 }
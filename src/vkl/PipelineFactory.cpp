@@ -70,6 +70,17 @@ namespace vkl
 			return nullptr;
 		return &(*findWhere);
 	}
+	size_t PipelineManager::pipelineIndex(std::type_index type) const
+	{
+		const Pipeline* pipeline = pipelineForType(type);
+		if (!pipeline)
+			return _pipelines.size();
+		return pipeline - _pipelines.data();
+	}
+	size_t PipelineManager::pipelineCount() const
+	{
+		return _pipelines.size();
+	}
 	void PipelineManager::cleanUp(const Device& device)
 	{
 		for (auto&& pipeline : _pipelines)
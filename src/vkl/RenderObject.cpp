@@ -8,106 +8,415 @@
 #include <vkl/DrawCall.h>
 #include <vkl/IndexBuffer.h>
 #include <vkl/PipelineFactory.h>
+#include <vkl/DescriptorAllocator.h>
+#include <vkl/BindlessTextures.h>
+#include <vkl/GpuCulling.h>
 
 #include <array>
+#include <cstring>
+#include <atomic>
 
 namespace vkl
 {
+	namespace
+	{
+		//fnv-1a over 64 bit values
+		struct SignatureHash
+		{
+			uint64_t value = 14695981039346656037ull;
+
+			void add(uint64_t v)
+			{
+				for (int i = 0; i < 8; ++i)
+				{
+					value ^= (v >> (i * 8)) & 0xFF;
+					value *= 1099511628211ull;
+				}
+			}
+
+			template <typename T>
+			void addHandle(T handle)
+			{
+				if constexpr (std::is_pointer_v<T>)
+					add((uint64_t)(uintptr_t)handle);
+				else
+					add((uint64_t)handle);
+			}
+
+			void addBytes(const void* data, size_t size)
+			{
+				const uint8_t* bytes = (const uint8_t*)data;
+				for (size_t i = 0; i < size; ++i)
+				{
+					value ^= bytes[i];
+					value *= 1099511628211ull;
+				}
+			}
+		};
+	}
+
 	void RenderObject::recordCommands(const SwapChain& swapChain, const PipelineManager& pipelines, VkCommandBuffer buffer, const VkExtent2D& extent)
 	{
-		const Pipeline* pipeline = pipelines.pipelineForType(std::type_index(typeid(*this)));
-		if (!pipeline)
+		const CompiledPacket* compiled = compiledPacket(swapChain, pipelines);
+		if (!compiled)
 			return;
 
-		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->handle());
+		recordDrawPacket(buffer, compiled->packet, compiled->draws.data(), extent);
+	}
 
-		std::vector<VkBuffer> vbos;
-		std::vector<VkDeviceSize> offsets;
-		for (auto&& vbo : _vbos)
-		{
-			vbos.push_back(vbo.second->handle(swapChain.frame()));
-			offsets.push_back(0);
-		}
+	bool RenderObject::appendDrawPacket(const SwapChain& swapChain, const PipelineManager& pipelines, std::vector<DrawPacket>& packets, std::vector<PacketDraw>& draws)
+	{
+		const CompiledPacket* compiled = compiledPacket(swapChain, pipelines);
+		if (!compiled)
+			return false;
+
+		DrawPacket& packet = packets.emplace_back(compiled->packet);
+		packet.firstDraw = (uint32_t)draws.size();
+		draws.insert(draws.end(), compiled->draws.begin(), compiled->draws.end());
+		return true;
+	}
 
-		if(!vbos.empty())
-			vkCmdBindVertexBuffers(buffer, 0, (uint32_t)vbos.size(), vbos.data(), offsets.data());
+	bool RenderObject::appendDepthPacket(const SwapChain& swapChain, const PipelineManager& pipelines, std::vector<DrawPacket>& packets, std::vector<PacketDraw>& draws)
+	{
+		const CompiledPacket* compiled = compiledPacket(swapChain, pipelines);
+		if (!compiled)
+			return false;
+
+		const Pipeline* pipeline = compiled->pipeline;
+		if (!pipeline || !pipeline->depthOnlyHandle())
+			return false;
+		//blended objects only go without the pre-pass when their pipeline can actually blend
+		if (_renderQueue == RenderQueue::Blend && pipeline->blendHandle())
+			return false;
+
+		DrawPacket& packet = packets.emplace_back(compiled->packet);
+		packet.pipeline = _renderQueue == RenderQueue::Mask && pipeline->maskDepthOnlyHandle() ? pipeline->maskDepthOnlyHandle() : pipeline->depthOnlyHandle();
+		packet.firstDraw = (uint32_t)draws.size();
+		draws.insert(draws.end(), compiled->draws.begin(), compiled->draws.end());
+		return true;
+	}
 
-		vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipelineLayoutHandle(), 0, 1, &_descriptorSets[swapChain.frame()], 0, nullptr);
+	const RenderObject::CompiledPacket* RenderObject::compiledPacket(const SwapChain& swapChain, const PipelineManager& pipelines)
+	{
+		if (!m_init)
+			return nullptr;
+
+		CompiledPacket& compiled = _packets[swapChain.frame()];
+		uint64_t version = sourceVersion();
+		if (compiled.bindingVersion == _bindingVersion && compiled.sourceVersion == version && compiled.pipelines == &pipelines)
+			return compiled.packet.pipeline ? &compiled : nullptr;
+
+		compiled.bindingVersion = _bindingVersion;
+		compiled.sourceVersion = version;
+		compiled.pipelines = &pipelines;
+		compiled.packet = {};
+		compiled.draws.clear();
+
+		const Pipeline* pipeline = pipelines.pipelineForType(std::type_index(typeid(*this)));
+		compiled.pipeline = pipeline;
+		if (!pipeline)
+			return nullptr;
+		//a pushed set has no allocated one to fall back on, nothing is drawn until every binding is there
+		if (_pushDescriptors && !_descriptorDataComplete[swapChain.frame()])
+			return nullptr;
 
+		if (_vbos.size() + _culledInstances.size() > MaxPacketVertexBuffers)
+		{
+			throw std::runtime_error("Error");
+		}
+
+		DrawPacket& packet = compiled.packet;
+		packet.pipeline = _renderQueue == RenderQueue::Blend && pipeline->blendHandle() ? pipeline->blendHandle() : pipeline->handle();
+		packet.layout = pipeline->pipelineLayoutHandle();
+		if (_pushDescriptors)
+		{
+			packet.pushDescriptors = pipeline->cmdPushDescriptorSetWithTemplate();
+			packet.pushTemplate = _descriptorTemplate;
+			packet.pushDescriptorData = _descriptorData[swapChain.frame()].data();
+		}
+		else
+		{
+			packet.descriptorSet = _descriptorSets[swapChain.frame()];
+			if (_dynamicUniforms)
+			{
+				packet.dynamicOffsets = _dynamicOffsets[swapChain.frame()].data();
+				packet.dynamicOffsetCount = (uint32_t)_dynamicOffsets[swapChain.frame()].size();
+			}
+		}
+		if (pipeline->usesBindlessTextures() && _bindlessTextures)
+			packet.bindlessSet = _bindlessTextures->setHandle();
 		if (_pushConstant)
-			vkCmdPushConstants(buffer, pipeline->pipelineLayoutHandle(), VK_SHADER_STAGE_VERTEX_BIT, 0, (uint32_t)_pushConstant->size(), _pushConstant->data());
+		{
+			packet.pushConstantData = _pushConstant->data();
+			packet.pushConstantSize = (uint32_t)_pushConstant->size();
+		}
+		//bindings are bound contiguously from 0
+		auto setVertexBuffer = [&](uint32_t binding, VkBuffer handle) {
+			if (binding >= MaxPacketVertexBuffers)
+			{
+				throw std::runtime_error("Error");
+			}
+			packet.vertexBuffers[binding] = handle;
+			packet.vertexOffsets[binding] = 0;
+			packet.vertexBufferCount = std::max(packet.vertexBufferCount, binding + 1);
+		};
+		for (auto&& vbo : _vbos)
+			setVertexBuffer(vbo.first, vbo.second->handle(swapChain.frame()));
+		for (auto&& culled : _culledInstances)
+			setVertexBuffer(culled.first, culled.second->visibleInstanceBuffer(swapChain.frame()));
 
 		for (auto&& dc : _drawCalls)
 		{
-			//TODO - let draw calls scissor
+			VkBuffer indexBuffer = dc->indexBuffer() ? dc->indexBuffer()->handle(swapChain.frame()) : VK_NULL_HANDLE;
+			VkIndexType indexType = dc->indexType();
+			if (const auto& culler = dc->indirect())
+			{
+				if (!indexBuffer)
+				{
+					throw std::runtime_error("Error");
+				}
+				uint32_t firstDraw = dc->indirectFirstDraw();
+				uint32_t drawCount = dc->indirectDrawCount();
+				VkBuffer commands = culler->commandBuffer(swapChain.frame());
+				if (drawCount == 0 || !commands)
+					continue;
+
+				if (culler->cmdDrawIndexedIndirectCount() && firstDraw == 0 && drawCount == culler->drawCount())
+				{
+					//the whole culler, only draws with something visible go to the gpu
+					packet.drawIndirectCount = culler->cmdDrawIndexedIndirectCount();
+					compiled.draws.push_back({ indexBuffer, indexType, drawCount, 0, 0, 0, 0, culler->compactedCommandBuffer(swapChain.frame()), culler->countBuffer(swapChain.frame()), 0 });
+				}
+				else if (culler->multiDrawIndirect())
+				{
+					compiled.draws.push_back({ indexBuffer, indexType, drawCount, 0, 0, 0, 0, commands, VK_NULL_HANDLE, firstDraw * (VkDeviceSize)GpuCuller::CommandStride });
+				}
+				else
+				{
+					for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw)
+						compiled.draws.push_back({ indexBuffer, indexType, 1, 0, 0, 0, 0, commands, VK_NULL_HANDLE, draw * (VkDeviceSize)GpuCuller::CommandStride });
+				}
+				continue;
+			}
+			if (dc->instanceCount() == 0)
+				continue;
+			compiled.draws.push_back({ indexBuffer, indexType, (uint32_t)dc->count(), (uint32_t)dc->offset(), dc->vertexOffset(), (uint32_t)dc->instanceCount(), (uint32_t)dc->firstInstance() });
+		}
+		packet.firstDraw = 0;
+		packet.drawCount = (uint32_t)compiled.draws.size();
+		return &compiled;
+	}
 
-			VkRect2D scissor{};
+	const Pipeline* RenderObject::pipelineFor(size_t frame, const PipelineManager& pipelines) const
+	{
+		if (frame < _packets.size() && _packets[frame].pipelines == &pipelines)
+			return _packets[frame].pipeline;
+		return pipelines.pipelineForType(std::type_index(typeid(*this)));
+	}
 
-			scissor.offset = { 0, 0 };
-			scissor.extent = extent;
+	uint64_t RenderObject::sourceVersion() const
+	{
+		uint64_t version = 0;
+		for (auto&& vbo : _vbos)
+			version += vbo.second->packetVersion();
+		for (auto&& culled : _culledInstances)
+			version += culled.second->packetVersion();
+		for (auto&& dc : _drawCalls)
+		{
+			version += dc->packetVersion();
+			if (const auto& indexBuffer = dc->indexBuffer())
+				version += indexBuffer->packetVersion();
+			if (const auto& culler = dc->indirect())
+				version += culler->packetVersion();
+		}
+		return version;
+	}
 
-			vkCmdSetScissor(buffer, 0, 1, &scissor);
+	void RenderObject::updateDescriptors(const Device& device, const SwapChain& swapChain, const PipelineManager& pipelines)
+	{
+		if (!m_init)
+			initPipeline(device, swapChain, pipelines);
 
-			if (dc->indexBuffer())
+		size_t frame = swapChain.frame();
+		auto& boundUniforms = _boundUniforms[frame];
+		auto& boundTextures = _boundTextures[frame];
+		//bindings were added/removed, forget what this slot had
+		if (boundUniforms.size() != _uniforms.size())
+			boundUniforms.assign(_uniforms.size(), {});
+		if (boundTextures.size() != _textures.size())
+			boundTextures.assign(_textures.size(), {});
+
+		//rewriting a set invalidates every command buffer it is bound in, so only touch it when a binding changed
+		_changedUniforms.clear();
+		_changedTextures.clear();
+		for (size_t i = 0; i < _uniforms.size(); ++i)
+		{
+			auto&& uniform = _uniforms[i];
+			if (!uniform.second->isValid(frame))
+				continue;
+
+			BoundUniform current{ uniform.first, uniform.second->handle(frame), _dynamicUniforms ? 0 : uniform.second->offset(frame), uniform.second->size() };
+			BoundUniform& bound = boundUniforms[i];
+			if (bound.binding == current.binding && bound.buffer == current.buffer && bound.offset == current.offset && bound.size == current.size)
+				continue;
+			bound = current;
+			_changedUniforms.push_back((uint32_t)i);
+		}
+		for (size_t i = 0; i < _textures.size(); ++i)
+		{
+			auto&& tex = _textures[i];
+			if (!tex.second->isValid(frame))
+				continue;
+
+			BoundTexture current{ tex.first, tex.second->imageViewHandle(), tex.second->samplerHandle() };
+			BoundTexture& bound = boundTextures[i];
+			if (bound.binding == current.binding && bound.view == current.view && bound.sampler == current.sampler)
+				continue;
+			bound = current;
+			_changedTextures.push_back((uint32_t)i);
+		}
+
+		//a uniform that moved within its ring page only changes its offset, no descriptor write
+		if (_dynamicUniforms)
+		{
+			auto& offsets = _dynamicOffsets[frame];
+			for (size_t i = 0; i < _dynamicBindings.size(); ++i)
 			{
-				vkCmdBindIndexBuffer(buffer, dc->indexBuffer()->handle(swapChain.frame()), 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(buffer, (uint32_t)dc->count(), 1, (uint32_t)dc->offset(), 0, 0);
+				auto uniform = std::find_if(_uniforms.begin(), _uniforms.end(), [&](const auto& rhs) { return rhs.first == _dynamicBindings[i]; });
+				offsets[i] = uniform != _uniforms.end() && uniform->second->isValid(frame) ? (uint32_t)uniform->second->offset(frame) : 0;
 			}
-			else
+		}
+
+		if (_changedUniforms.empty() && _changedTextures.empty())
+			return;
+		++_descriptorVersions[frame];
+
+		//every binding the pipeline declares is there, the whole set goes in one templated call
+		if (packDescriptorData(frame))
+		{
+			//pushed data goes out with the draw's commands, nothing is written here
+			if (!_pushDescriptors)
 			{
-				vkCmdDraw(buffer, (uint32_t)dc->count(), 1, (uint32_t)dc->offset(), 0);
+				vkUpdateDescriptorSetWithTemplate(device.handle(), _descriptorSets[frame], _descriptorTemplate, _descriptorData[frame].data());
+				descriptorWriteCounter().fetch_add(_description->uniforms().size() + _description->textures().size(), std::memory_order_relaxed);
 			}
+			return;
+		}
+
+		//pushed sets can't be written piecemeal, the object just isn't complete yet
+		if (_pushDescriptors)
+			return;
+
+		_writes.clear();
+		_bufferInfos.clear();
+		_imageInfos.clear();
+		_bufferInfos.reserve(_changedUniforms.size());
+		_imageInfos.reserve(_changedTextures.size());
+
+		for (auto&& index : _changedUniforms)
+		{
+			const BoundUniform& bound = boundUniforms[index];
+
+			VkDescriptorBufferInfo& bufferInfo = _bufferInfos.emplace_back();
+			bufferInfo.buffer = bound.buffer;
+			bufferInfo.offset = bound.offset;
+			bufferInfo.range = bound.size;
+
+			VkWriteDescriptorSet& descriptorWrite = _writes.emplace_back();
+			descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = _descriptorSets[frame];
+			descriptorWrite.dstBinding = bound.binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = _dynamicUniforms ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pBufferInfo = &bufferInfo;
+		}
+		for (auto&& index : _changedTextures)
+		{
+			const BoundTexture& bound = boundTextures[index];
+
+			VkDescriptorImageInfo& imageInfo = _imageInfos.emplace_back();
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = bound.view;
+			imageInfo.sampler = bound.sampler;
+
+			VkWriteDescriptorSet& descriptorWrite = _writes.emplace_back();
+			descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = _descriptorSets[frame];
+			descriptorWrite.dstBinding = bound.binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pImageInfo = &imageInfo;
 		}
 
+		vkUpdateDescriptorSets(device.handle(), (uint32_t)_writes.size(), _writes.data(), 0, nullptr);
+		descriptorWriteCounter().fetch_add(_writes.size(), std::memory_order_relaxed);
 	}
 
-	void RenderObject::updateDescriptors(const Device& device, const SwapChain& swapChain, const PipelineManager& pipelines)
+	bool RenderObject::packDescriptorData(size_t frame)
 	{
-		if (!m_init)
-			initPipeline(device, swapChain, pipelines);
+		if (_descriptorTemplate == VK_NULL_HANDLE)
+			return false;
 
-		for (auto&& uniform : _uniforms)
+		uint8_t* data = _descriptorData[frame].data();
+		bool complete = true;
+		for (auto&& declared : _description->uniforms())
 		{
-			if (uniform.second->isValid(swapChain.frame()))
+			auto uniform = std::find_if(_uniforms.begin(), _uniforms.end(), [&](const auto& rhs) { return rhs.first == declared.binding; });
+			if (uniform == _uniforms.end() || !uniform->second->isValid(frame))
 			{
-				VkDescriptorBufferInfo bufferInfo{};
-				bufferInfo.buffer = uniform.second->handle(swapChain.frame());
-				bufferInfo.offset = 0;
-				bufferInfo.range = uniform.second->size();
-
-				VkWriteDescriptorSet descriptorWrite{};
-				descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				descriptorWrite.dstSet = _descriptorSets[swapChain.frame()];
-				descriptorWrite.dstBinding = uniform.first;
-				descriptorWrite.dstArrayElement = 0;
-				descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				descriptorWrite.descriptorCount = 1;
-				descriptorWrite.pBufferInfo = &bufferInfo;
-
-				vkUpdateDescriptorSets(device.handle(), 1, &descriptorWrite, 0, nullptr);
+				complete = false;
+				break;
 			}
+
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = uniform->second->handle(frame);
+			bufferInfo.offset = _dynamicUniforms ? 0 : uniform->second->offset(frame);
+			bufferInfo.range = uniform->second->size();
+			std::memcpy(data, &bufferInfo, sizeof(bufferInfo));
+			data += sizeof(bufferInfo);
 		}
-		for (auto&& tex : _textures)
+		for (auto&& declared : _description->textures())
 		{
-			if (tex.second->isValid(swapChain.frame()))
+			if (!complete)
+				break;
+
+			auto tex = std::find_if(_textures.begin(), _textures.end(), [&](const auto& rhs) { return rhs.first == declared.binding; });
+			if (tex == _textures.end() || !tex->second->isValid(frame))
 			{
-				VkDescriptorImageInfo imageInfo{};
-				imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				imageInfo.imageView = tex.second->imageViewHandle();
-				imageInfo.sampler = tex.second->samplerHandle();
-
-				VkWriteDescriptorSet descriptorWrite{};
-				descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				descriptorWrite.dstSet = _descriptorSets[swapChain.frame()];
-				descriptorWrite.dstBinding = tex.first;
-				descriptorWrite.dstArrayElement = 0;
-				descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-				descriptorWrite.descriptorCount = 1;
-				descriptorWrite.pImageInfo = &imageInfo;
-
-				vkUpdateDescriptorSets(device.handle(), 1, &descriptorWrite, 0, nullptr);
+				complete = false;
+				break;
 			}
+
+			VkDescriptorImageInfo imageInfo{};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.imageView = tex->second->imageViewHandle();
+			imageInfo.sampler = tex->second->samplerHandle();
+			std::memcpy(data, &imageInfo, sizeof(imageInfo));
+			data += sizeof(imageInfo);
 		}
+
+		//packets only point at complete data
+		if ((bool)_descriptorDataComplete[frame] != complete)
+		{
+			_descriptorDataComplete[frame] = complete;
+			++_bindingVersion;
+		}
+		return complete;
+	}
+
+	uint64_t RenderObject::descriptorWriteCount()
+	{
+		return descriptorWriteCounter().load(std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t>& RenderObject::descriptorWriteCounter()
+	{
+		static std::atomic<uint64_t> writes{ 0 };
+		return writes;
 	}
 
 	std::shared_ptr<const PipelineDescription> RenderObject::pipelineDescription() const
@@ -115,17 +424,182 @@ namespace vkl
 		return PipelineMetaFactory::instance().description(std::type_index(typeid(*this)));
 	}
 
+	uint64_t RenderObject::sortKey(const PipelineManager& pipelines) const
+	{
+		uint64_t pipeline = std::min<uint64_t>(pipelines.pipelineIndex(std::type_index(typeid(*this))), 0xFFF);
+		uint64_t queue = uint64_t(_renderQueue) & 0x3;
+
+		//positive floats sort the same as their bits
+		float depth = std::max(_sortDepth, 0.f);
+		uint32_t depthBits = 0;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+		//back to front, state only matters between equal depths
+		if (_renderQueue == RenderQueue::Blend)
+			return (uint64_t(_sortLayer) << 56) | (queue << 54) | (uint64_t(~depthBits) << 22) | (pipeline << 10) | (_materialHash & 0x3FF);
+
+		//keep the top 22 depth bits
+		uint64_t depthKey = depthBits >> 9;
+		return (uint64_t(_sortLayer) << 56) | (queue << 54) | (pipeline << 42) | (uint64_t(_materialHash & 0xFFFFF) << 22) | depthKey;
+	}
+
+	uint64_t RenderObject::depthSortKey() const
+	{
+		float depth = std::max(_sortDepth, 0.f);
+		uint32_t depthBits = 0;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+		return (uint64_t(_sortLayer) << 56) | depthBits;
+	}
+
+	void RenderObject::setRenderQueue(RenderQueue queue)
+	{
+		if (_renderQueue == queue)
+			return;
+		_renderQueue = queue;
+		++_bindingVersion;
+	}
+	RenderQueue RenderObject::renderQueue() const
+	{
+		return _renderQueue;
+	}
+	void RenderObject::setSortLayer(uint8_t layer)
+	{
+		_sortLayer = layer;
+	}
+	uint8_t RenderObject::sortLayer() const
+	{
+		return _sortLayer;
+	}
+	void RenderObject::setSortDepth(float depth)
+	{
+		_sortDepth = depth;
+	}
+	float RenderObject::sortDepth() const
+	{
+		return _sortDepth;
+	}
+	void RenderObject::setBoundingSphere(float x, float y, float z, float radius)
+	{
+		_boundingSphere = { x, y, z, radius };
+		_hasBoundingSphere = true;
+	}
+	void RenderObject::clearBoundingSphere()
+	{
+		_hasBoundingSphere = false;
+	}
+	bool RenderObject::hasBoundingSphere() const
+	{
+		return _hasBoundingSphere;
+	}
+	const std::array<float, 4>& RenderObject::boundingSphere() const
+	{
+		return _boundingSphere;
+	}
+
+	void RenderObject::setStatic(bool isStatic)
+	{
+		_static = isStatic;
+	}
+	bool RenderObject::isStatic() const
+	{
+		return _static;
+	}
+
+	uint64_t RenderObject::commandSignature(const SwapChain& swapChain, const PipelineManager& pipelines, VkFramebuffer frameBuffer, const VkExtent2D& extent) const
+	{
+		size_t frame = swapChain.frame();
+		const Pipeline* pipeline = pipelineFor(frame, pipelines);
+
+		SignatureHash hash;
+		hash.addHandle(frameBuffer);
+		hash.add(extent.width);
+		hash.add(extent.height);
+		hash.addHandle(pipeline ? pipeline->handle() : VK_NULL_HANDLE);
+		hash.add((uint64_t)_renderQueue);
+		if (!_descriptorVersions.empty())
+		{
+			//pushed descriptors are baked into the buffer, so the version covers them too
+			hash.addHandle(_descriptorSets.empty() ? VK_NULL_HANDLE : _descriptorSets[frame]);
+			hash.add(_descriptorVersions[frame]);
+		}
+		if (_dynamicUniforms && !_dynamicOffsets.empty())
+			hash.addBytes(_dynamicOffsets[frame].data(), _dynamicOffsets[frame].size() * sizeof(uint32_t));
+		for (auto&& vbo : _vbos)
+		{
+			hash.add(vbo.first);
+			hash.addHandle(vbo.second->handle(frame));
+		}
+		for (auto&& culled : _culledInstances)
+		{
+			hash.add(culled.first);
+			hash.addHandle(culled.second->visibleInstanceBuffer(frame));
+		}
+		if (_pushConstant)
+			hash.addBytes(_pushConstant->data(), _pushConstant->size());
+		for (auto&& dc : _drawCalls)
+		{
+			hash.addHandle(dc->indexBuffer() ? dc->indexBuffer()->handle(frame) : VK_NULL_HANDLE);
+			hash.add(dc->count());
+			hash.add(dc->offset());
+			hash.add(dc->vertexOffset());
+			hash.add(dc->indexType());
+			hash.add(dc->instanceCount());
+			hash.add(dc->firstInstance());
+			if (const auto& culler = dc->indirect())
+			{
+				hash.addHandle(culler->commandBuffer(frame));
+				hash.addHandle(culler->compactedCommandBuffer(frame));
+				hash.add(culler->drawCount());
+				hash.add(dc->indirectFirstDraw());
+				hash.add(dc->indirectDrawCount());
+			}
+		}
+		return hash.value;
+	}
+
+	uint64_t RenderObject::objectId() const
+	{
+		return _objectId;
+	}
+	size_t RenderObject::drawCallCount() const
+	{
+		return _drawCalls.size();
+	}
+	float RenderObject::recordCost() const
+	{
+		return _recordCost;
+	}
+	void RenderObject::setRecordCost(float nanos)
+	{
+		_recordCost = nanos;
+	}
+	uint64_t RenderObject::nextObjectId()
+	{
+		static std::atomic<uint64_t> nextId{ 1 };
+		return nextId.fetch_add(1);
+	}
+
 	void RenderObject::cleanUp(const Device& device)
 	{
-		vkDestroyDescriptorPool(device.handle(), _descriptorPool, nullptr);
+		if (!_descriptorSets.empty())
+			device.descriptorAllocator().free(_descriptorSetLayout, _descriptorSets);
+		_descriptorSets.clear();
+		m_init = false;
 	}
 
 	void RenderObject::addVBO(std::shared_ptr<const VertexBuffer> vbo, uint32_t binding)
 	{
 		_vbos.push_back({ binding, vbo });
+		++_bindingVersion;
 		std::sort(_vbos.begin(), _vbos.end(), [](const auto& lhs, const auto& rhs) {
 			return lhs.first < rhs.first;
 			});
+		updateMaterialHash();
+	}
+	void RenderObject::addCulledInstances(std::shared_ptr<const GpuCuller> culler, uint32_t binding)
+	{
+		_culledInstances.push_back({ binding, culler });
+		++_bindingVersion;
 	}
 	void RenderObject::addUniform(std::shared_ptr<const UniformBuffer> uniform, uint32_t binding)
 	{
@@ -141,23 +615,57 @@ namespace vkl
 		std::sort(_textures.begin(), _textures.end(), [](const auto& lhs, const auto& rhs) {
 			return lhs.first < rhs.first;
 			});
+		updateMaterialHash();
 
 	}
 	void RenderObject::addDrawCall(std::shared_ptr<const DrawCall> draw)
 	{
 		_drawCalls.push_back(draw);
+		++_bindingVersion;
+	}
+	void RenderObject::setDrawCall(size_t index, std::shared_ptr<const DrawCall> draw)
+	{
+		if (index >= _drawCalls.size() || _drawCalls[index] == draw)
+			return;
+		_drawCalls[index] = draw;
+		++_bindingVersion;
 	}
 	void RenderObject::setPushConstant(std::shared_ptr<const PushConstantBase> pc)
 	{
 		_pushConstant = pc;
+		++_bindingVersion;
+	}
+	void RenderObject::setBindlessTextures(std::shared_ptr<const BindlessTextureTable> table)
+	{
+		_bindlessTextures = table;
+		++_bindingVersion;
 	}
 	void RenderObject::reset()
 	{
 		_textures.clear();
 		_pushConstant = nullptr;
+		_bindlessTextures = nullptr;
 		_drawCalls.clear();
 		_vbos.clear();
+		_culledInstances.clear();
 		_uniforms.clear();
+		++_bindingVersion;
+		updateMaterialHash();
+	}
+	void RenderObject::updateMaterialHash()
+	{
+		SignatureHash hash;
+		for (auto&& tex : _textures)
+		{
+			hash.add(tex.first);
+			hash.addHandle(tex.second.get());
+		}
+		for (auto&& vbo : _vbos)
+		{
+			hash.add(vbo.first);
+			hash.addHandle(vbo.second.get());
+		}
+		_materialHash = (uint32_t)(hash.value ^ (hash.value >> 32));
 	}
 
 	void RenderObject::initPipeline(const Device& device, const SwapChain& swapChain,const PipelineManager& pipelines)
@@ -176,36 +684,42 @@ namespace vkl
 			return;
 		}
 
-		//Descriptor Pool
-		std::array<VkDescriptorPoolSize, 2> poolSizes{};
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChain.framesInFlight()) * std::max(1u, (uint32_t)description->uniforms().size());
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChain.framesInFlight()) * std::max(1u, (uint32_t)description->textures().size());
-
-		VkDescriptorPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = static_cast<uint32_t>(swapChain.framesInFlight());
-
-		if (vkCreateDescriptorPool(device.handle(), &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
-			throw std::runtime_error("Error");
+		//one set's worth, the device's allocator pages these per layout
+		std::array<VkDescriptorPoolSize, 2> setSizes{};
+		setSizes[0].type = pipeline->uniformDescriptorType();
+		setSizes[0].descriptorCount = std::max(1u, (uint32_t)description->uniforms().size());
+		setSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		setSizes[1].descriptorCount = std::max(1u, (uint32_t)description->textures().size());
+
+		_description = description;
+		_descriptorTemplate = pipeline->descriptorTemplateHandle();
+		_pushDescriptors = pipeline->usesPushDescriptors();
+		_dynamicUniforms = pipeline->usesDynamicUniforms();
+		_dynamicBindings.clear();
+		if (_dynamicUniforms)
+		{
+			//dynamic offsets are consumed in binding order, not declaration order
+			for (auto&& uniform : description->uniforms())
+				_dynamicBindings.push_back(uniform.binding);
+			std::sort(_dynamicBindings.begin(), _dynamicBindings.end());
 		}
+		_dynamicOffsets.assign(swapChain.framesInFlight(), std::vector<uint32_t>(_dynamicBindings.size(), 0));
+		_descriptorData.assign(swapChain.framesInFlight(), std::vector<uint8_t>(pipeline->descriptorDataSize()));
+		_descriptorDataComplete.assign(swapChain.framesInFlight(), 0);
 
-
-		_descriptorSets.resize(swapChain.framesInFlight());
-		std::vector<VkDescriptorSetLayout> layouts(swapChain.framesInFlight(), pipeline->descriptorSetLayoutHandle());
-
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = _descriptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChain.framesInFlight());
-		allocInfo.pSetLayouts = layouts.data();
-
-		if (vkAllocateDescriptorSets(device.handle(), &allocInfo, _descriptorSets.data()) != VK_SUCCESS) {
-			throw std::runtime_error("Error");
+		//pushed sets are written straight into the command buffer, nothing to allocate
+		_descriptorSetLayout = pipeline->descriptorSetLayoutHandle();
+		if (!_pushDescriptors)
+		{
+			_descriptorSets.resize(swapChain.framesInFlight());
+			device.descriptorAllocator().allocate(device, _descriptorSetLayout, setSizes, _descriptorSets);
 		}
+
+		_descriptorVersions.assign(swapChain.framesInFlight(), 0);
+		_boundUniforms.assign(swapChain.framesInFlight(), {});
+		_boundTextures.assign(swapChain.framesInFlight(), {});
+		_packets.clear();
+		_packets.resize(swapChain.framesInFlight());
 		m_init = true;
 	}
 }
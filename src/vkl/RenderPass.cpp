@@ -23,7 +23,7 @@ namespace vkl
         depthAttachment.format = swapChain.depthFormat();
         depthAttachment.samples = device.maxUsableSamples();
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.storeOp = options.occlusionCulling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -80,13 +80,40 @@ namespace vkl
             throw std::runtime_error("Error");
         }
 
+        if (options.occlusionCulling)
+        {
+            //compatible with the first pass, only load ops and layouts differ
+            attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+            //everything the first pass and the hi-z build did has to land before this pass touches the attachments again
+            VkSubpassDependency resumeDependency{};
+            resumeDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+            resumeDependency.dstSubpass = 0;
+            resumeDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            resumeDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            resumeDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            resumeDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            renderPassInfo.pDependencies = &resumeDependency;
+
+            if (vkCreateRenderPass(device.handle(), &renderPassInfo, nullptr, &_resumePass) != VK_SUCCESS) {
+                throw std::runtime_error("Error");
+            }
+        }
 	}
 	
 	VkRenderPass RenderPass::handle() const
 	{
 		return _renderPass;
 	}
-    const RenderPassOptions& RenderPass::options() const
+    VkRenderPass RenderPass::resumeHandle() const
+    {
+        return _resumePass;
+    }
+        const RenderPassOptions& RenderPass::options() const
     {
         return _options;
     }
@@ -94,5 +121,8 @@ namespace vkl
     void RenderPass::cleanUp(const Device& device)
     {
         vkDestroyRenderPass(device.handle(), _renderPass, nullptr);
+        if (_resumePass != VK_NULL_HANDLE)
+            vkDestroyRenderPass(device.handle(), _resumePass, nullptr);
+        _resumePass = VK_NULL_HANDLE;
     }
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <vkl/Instance.h>
 #include <vkl/RenderPass.h>
 #include <vkl/CommandDispatcher.h>
+#include <vkl/DescriptorAllocator.h>
+#include <vkl/DeletionQueue.h>
 
 namespace vkl
 {
@@ -244,8 +246,17 @@ namespace vkl
     {
         _swapChainDepthFormat = findDepthFormat(device.physicalDeviceHandle());
 
+        //sampled when the format allows it, OcclusionCuller builds its hi-z chain from it
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(device.physicalDeviceHandle(), _swapChainDepthFormat, &props);
+        _depthSampled = (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (_depthSampled)
+            usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
         createImage(device, _swapChainExtent.width, _swapChainExtent.height, 1, device.maxUsableSamples(), _swapChainDepthFormat, VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageMemory);
+            usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageMemory);
         
         _depthImageView = createImageView(device, _depthImage, _swapChainDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
     }
@@ -287,6 +298,21 @@ namespace vkl
         return _swapChainDepthFormat;
     }
 
+    VkImage SwapChain::depthImage() const
+    {
+        return _depthImage;
+    }
+
+    VkImageView SwapChain::depthImageView() const
+    {
+        return _depthImageView;
+    }
+
+    bool SwapChain::depthSampled() const
+    {
+        return _depthSampled;
+    }
+
     uint32_t SwapChain::graphicsFamilyQueueIndex() const
     {
         return _graphicsFamilyQueueIndex;
@@ -348,6 +374,15 @@ namespace vkl
 
         _imageIndex = imageIndex;
 
+        //wait for the last submit that used this image before anything for it gets recorded or reset
+        if (_imagesInFlight[_imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(device.handle(), 1, &_imagesInFlight[_imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        _imagesInFlight[_imageIndex] = VK_NULL_HANDLE;
+
+        device.descriptorAllocator().collect(framesInFlight());
+        device.deletionQueue().collect(device, framesInFlight());
+
         if (!_prepped)
         {
             VkCommandBufferBeginInfo beginInfo{};
@@ -372,9 +407,6 @@ namespace vkl
 
 
 
-        if (_imagesInFlight[_imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(device.handle(), 1, &_imagesInFlight[_imageIndex], VK_TRUE, UINT64_MAX);
-        }
         _imagesInFlight[_imageIndex] = _inFlightFences[_frameClamp];
 
         VkSubmitInfo submitInfo{};
@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include <vkl/Device.h>
+#include <vkl/DeletionQueue.h>
 #include <vkl/SwapChain.h>
 
 namespace vkl
@@ -46,9 +47,8 @@ namespace vkl
 		transitionImageLayout(device, swapChain, swapChain.frame(), _image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
 		copyBufferToImage(device, swapChain, swapChain.frame(), stagingBuffer, _image, static_cast<uint32_t>(_width), static_cast<uint32_t>(_height));
 
-		_createFrame = swapChain.frame();
-		_stagingBuffer = stagingBuffer;
-		_stagingMemory = stagingBufferMemory;
+		//the copy is in this frame's one off commands
+		device.deletionQueue().destroyBuffer(stagingBuffer, stagingBufferMemory);
 
 		generateMipmaps(device, swapChain, swapChain.frame(), _image, VK_FORMAT_R8G8B8A8_SRGB, (uint32_t)_width, (uint32_t)_height, mipLevels);
 
@@ -120,25 +120,19 @@ namespace vkl
 	{
 		return _sampler;
 	}
-	void TextureBuffer::cleanUp(const Device& device)
+	uint32_t TextureBuffer::bindlessIndex() const
 	{
-		vkDestroySampler(device.handle(), _sampler, nullptr);
-		vkDestroyImageView(device.handle(), _imageView, nullptr);
-		vmaDestroyImage(device.allocatorHandle(), _image, _memory);
+		return _bindlessIndex;
 	}
-	void TextureBuffer::update(const Device& device, const SwapChain& swapChain)
+	void TextureBuffer::cleanUp(const Device& device)
 	{
-		if (!_seenFirstUpdate)
-		{
-			_seenFirstUpdate = true;
-			return;
-		}
-
-		if (_stagingBuffer != VK_NULL_HANDLE && _createFrame == swapChain.frame())
-		{
-			vmaDestroyBuffer(device.allocatorHandle(), _stagingBuffer, _stagingMemory);
-			_stagingBuffer = VK_NULL_HANDLE;
-			_stagingMemory = {};
-		}
+		//frames in flight may still sample it, BufferManager::cleanUnusedBuffers
+		device.deletionQueue().destroySampler(_sampler);
+		device.deletionQueue().destroyImageView(_imageView);
+		device.deletionQueue().destroyImage(_image, _memory);
+		_sampler = VK_NULL_HANDLE;
+		_imageView = VK_NULL_HANDLE;
+		_image = VK_NULL_HANDLE;
+		_memory = {};
 	}
 }
\ No newline at end of file
@@ -3,31 +3,45 @@
 #include <vkl/Device.h>
 #include <vkl/SwapChain.h>
 
+#include <algorithm>
 #include <cstring>
 
 namespace vkl
 {
-    UniformBuffer::UniformBuffer(const Device& device, const SwapChain& swapChain)
+    UniformBuffer::UniformBuffer(const Device& device, const SwapChain& swapChain, std::shared_ptr<UniformRing> ring)
+        : _ring(ring)
     {
-        _buffers.resize(swapChain.framesInFlight());
+        _slots.resize(swapChain.framesInFlight());
         _dirties.resize(swapChain.framesInFlight());
     }
 
     void UniformBuffer::setData(void* data, size_t size)
     {
+        bool unchanged = _changeDetection && _contentHash.unchanged(data, size) && size == _size;
+
         _data = data;
         _size = size;
+        if (unchanged)
+            return;
+
+        for (auto&& dirty : _dirties)
+            dirty.addAll();
+        markDirty();
+    }
+
+    void UniformBuffer::updateRange(size_t offset, size_t size)
+    {
+        _contentHash.reset();
         for (auto&& dirty : _dirties)
-            dirty = true;
+            dirty.add(offset, size);
+        markDirty();
     }
 
     void UniformBuffer::update(const Device& device, const SwapChain& swapChain)
     {
-        if (!_dirties[swapChain.frame()])
+        if (_dirties[swapChain.frame()].empty())
             return;
 
-        _dirties[swapChain.frame()] = false;
-
         updateBuffer(device, swapChain.frame());
     }
 
@@ -43,66 +57,75 @@ namespace vkl
 
     VkBuffer UniformBuffer::handle(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer;
+        return _ring ? _ring->buffer(frameIndex, _slots[frameIndex]) : VK_NULL_HANDLE;
+    }
+
+    VkDeviceSize UniformBuffer::offset(size_t frameIndex) const
+    {
+        return _slots[frameIndex].offset;
     }
 
     bool UniformBuffer::isValid(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer != VK_NULL_HANDLE;
+        return _slots[frameIndex].valid();
+    }
+
+    void UniformBuffer::setChangeDetection(bool enabled)
+    {
+        _changeDetection = enabled;
+        _contentHash.reset();
+    }
+
+    bool UniformBuffer::changeDetection() const
+    {
+        return _changeDetection;
     }
 
     void UniformBuffer::cleanUp(const Device& device)
     {
-        for (auto&& buffer : _buffers)
+        for (size_t frame = 0; frame < _slots.size(); ++frame)
         {
-            vmaDestroyBuffer(device.allocatorHandle(), buffer._buffer, buffer._memory);
-            buffer._memory = nullptr;
-            buffer._buffer = VK_NULL_HANDLE;
-            buffer._mapped = nullptr;
+            if (_ring)
+                _ring->release(frame, _slots[frame]);
         }
-        _buffers.clear();
+        _slots.clear();
     }
 
-    void UniformBuffer::updateBuffer(const Device& device, size_t frame)
+    bool UniformBuffer::flushDirty(const Device& device, const SwapChain& swapChain)
     {
-        auto& current = _buffers[frame];
+        update(device, swapChain);
+        return std::any_of(_dirties.begin(), _dirties.end(), [](const DirtyRanges& dirty) { return !dirty.empty(); });
+    }
 
-        if (isValid(frame))
+    void UniformBuffer::updateBuffer(const Device& device, size_t frame)
+    {
+        auto& dirty = _dirties[frame];
+        if (!_ring)
         {
-            //destroy buffer
-            if (current._buffer && current._memory)
-            {
-                vmaDestroyBuffer(device.allocatorHandle(), current._buffer, current._memory);
-                current._memory = nullptr;
-                current._buffer = VK_NULL_HANDLE;
-                current._mapped = nullptr;
-            }
+            dirty.clear();
+            return;
         }
 
-        if (!isValid(frame))
+        auto& slot = _slots[frame];
+
+        //slots are only written for their own frame once its fence was waited on, so trading one for a bigger one is safe
+        if (slot.valid() && slot.size < _size)
         {
-            //create buffer
-            VkBufferCreateInfo bufferInfo{};
-            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-            bufferInfo.size = _size;
-            bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-            VmaAllocationCreateInfo createAllocation{};
-            createAllocation.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-            createAllocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-            createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
-
-            VmaAllocationInfo info{};
-            vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &current._buffer, &current._memory, &info);
-
-            current._mapped = info.pMappedData;
+            _ring->release(frame, slot);
+            slot = {};
         }
 
-        //populate buffer
-        if (current._mapped && _data)
-            memcpy(current._mapped, _data, _size);
+        if (!slot.valid())
+        {
+            slot = _ring->allocate(device, frame, _size);
+            dirty.addAll();
+        }
 
+        //populate only the touched bytes of the slot
+        if (_data)
+            dirty.copy(_ring->mapped(frame, slot), _data, _size);
+        else
+            dirty.clear();
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,102 @@
+#include <vkl/UniformRing.h>
+
+#include <vkl/Device.h>
+#include <vkl/DeletionQueue.h>
+#include <vkl/SwapChain.h>
+
+namespace vkl
+{
+	UniformRing::UniformRing(const Device& device, const SwapChain& swapChain)
+	{
+		_frames.resize(swapChain.framesInFlight());
+		_alignment = device.minUniformBufferOffsetAlignment();
+	}
+
+	UniformRing::Slot UniformRing::allocate(const Device& device, size_t frame, VkDeviceSize size)
+	{
+		Frame& data = _frames[frame];
+		size = (std::max<VkDeviceSize>(size, 1) + _alignment - 1) / _alignment * _alignment;
+
+		auto released = data.free.find(size);
+		if (released != data.free.end() && !released->second.empty())
+		{
+			Slot slot = released->second.back();
+			released->second.pop_back();
+			return slot;
+		}
+
+		//only the newest page is bumped, the rest are full or hand out released slots
+		if (data.pages.empty() || data.pages.back().used + size > data.pages.back().size)
+		{
+			Page& page = data.pages.emplace_back();
+			page.size = std::max(PageSize, size);
+
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = page.size;
+			bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VmaAllocationCreateInfo createAllocation{};
+			createAllocation.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+			createAllocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+			VmaAllocationInfo info{};
+			if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &page.buffer, &page.memory, &info) != VK_SUCCESS) {
+				throw std::runtime_error("Error");
+			}
+			page.mapped = static_cast<uint8_t*>(info.pMappedData);
+		}
+
+		Page& page = data.pages.back();
+		Slot slot;
+		slot.page = (uint32_t)(data.pages.size() - 1);
+		slot.offset = page.used;
+		slot.size = size;
+		page.used += size;
+		return slot;
+	}
+
+	void UniformRing::release(size_t frame, const Slot& slot)
+	{
+		if (!slot.valid() || frame >= _frames.size())
+			return;
+		_frames[frame].free[slot.size].push_back(slot);
+	}
+
+	VkBuffer UniformRing::buffer(size_t frame, const Slot& slot) const
+	{
+		if (!slot.valid())
+			return VK_NULL_HANDLE;
+		return _frames[frame].pages[slot.page].buffer;
+	}
+
+	void* UniformRing::mapped(size_t frame, const Slot& slot) const
+	{
+		if (!slot.valid())
+			return nullptr;
+		return _frames[frame].pages[slot.page].mapped + slot.offset;
+	}
+
+	VkDeviceSize UniformRing::alignment() const
+	{
+		return _alignment;
+	}
+
+	size_t UniformRing::pageCount(size_t frame) const
+	{
+		return _frames[frame].pages.size();
+	}
+
+	void UniformRing::cleanUp(const Device& device)
+	{
+		for (auto&& frame : _frames)
+		{
+			for (auto&& page : frame.pages)
+				device.deletionQueue().destroyBuffer(page.buffer, page.memory);
+			frame.pages.clear();
+			frame.free.clear();
+		}
+	}
+}
@@ -2,58 +2,101 @@
 
 #include <vkl/Device.h>
 #include <vkl/SwapChain.h>
+#include <vkl/DeletionQueue.h>
 
+#include <algorithm>
 #include <cstring>
 
 namespace vkl
 {
-    VertexBuffer::VertexBuffer(const Device& device, const SwapChain& swapChain)
+    VertexBuffer::VertexBuffer(const Device& device, const SwapChain& swapChain, BufferUsage usage)
+        : _usage(usage)
     {
-        _buffers.resize(swapChain.framesInFlight());
+        _buffers.resize(_usage == BufferUsage::Static ? 1 : swapChain.framesInFlight());
         _dirties.resize(swapChain.framesInFlight());
     }
 
     void VertexBuffer::setData(void* data, size_t elementSize, size_t count)
     {
+        bool unchanged = _changeDetection && _contentHash.unchanged(data, elementSize * count) && elementSize == _elementSize && count == _count;
+
         _data = data;
         _elementSize = elementSize;
-        _oldCount = _count;
         _count = count;
+        if (unchanged)
+            return;
+
+        for (auto&& dirty : _dirties)
+            dirty.addAll();
+        markDirty();
+    }
+
+    void VertexBuffer::updateRange(size_t offset, size_t size)
+    {
+        _contentHash.reset();
         for (auto&& dirty : _dirties)
-            dirty = true;
+            dirty.add(offset, size);
+        markDirty();
     }
 
     void VertexBuffer::update(const Device& device, const SwapChain& swapChain)
     {
-        if (!_dirties[swapChain.frame()])
+        auto& dirty = _dirties[swapChain.frame()];
+        if (dirty.empty())
             return;
 
-        _dirties[swapChain.frame()] = false;
+        if (_usage == BufferUsage::Static)
+        {
+            //one upload covers every frame, a range update re-uploads it all
+            for (auto&& frameDirty : _dirties)
+                frameDirty.clear();
+            updateStatic(device, swapChain);
+            return;
+        }
 
         auto& current = _buffers[swapChain.frame()];
+        size_t size = _elementSize * _count;
 
-        if (_oldCount != _count && isValid(swapChain.frame()))
+        //grow geometrically, only shrink once the data stayed well under capacity for a while
+        size_t capacity = current._capacity;
+        if (size > capacity)
         {
-            //destroy buffer
-            if (current._buffer && current._memory)
-            {
-                vmaDestroyBuffer(device.allocatorHandle(), current._buffer, current._memory);
-                current._memory = nullptr;
-                current._buffer = VK_NULL_HANDLE;
-                current._mapped = nullptr;
-            }
+            capacity = std::max(size, capacity * 2);
+        }
+        else if (_shrinkEnabled && size * 4 <= capacity)
+        {
+            if (++current._smallUpdates >= ShrinkAfterUpdates)
+                capacity = size * 2;
+        }
+        else
+        {
+            current._smallUpdates = 0;
         }
 
-        if (_count == 0)
-            return;
+        if (capacity != current._capacity && current._buffer)
+        {
+            //a frame still in flight may be reading it
+            device.deletionQueue().destroyBuffer(current._buffer, current._memory);
+            current._memory = nullptr;
+            current._buffer = VK_NULL_HANDLE;
+            current._mapped = nullptr;
+            current._capacity = 0;
+            current._smallUpdates = 0;
+            ++_packetVersion;
+        }
 
+        if (capacity == 0)
+        {
+            dirty.clear();
+            return;
+        }
 
-        if (!isValid(swapChain.frame()))
+        if (!current._buffer)
         {
             //create buffer
             VkBufferCreateInfo bufferInfo{};
             bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-            bufferInfo.size = _elementSize * _count;
+            bufferInfo.size = capacity;
             bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
             bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -63,15 +106,54 @@ namespace vkl
             createAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
             VmaAllocationInfo info{};
-            vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &current._buffer, &current._memory, &info);
+            if (vmaCreateBuffer(device.allocatorHandle(), &bufferInfo, &createAllocation, &current._buffer, &current._memory, &info) != VK_SUCCESS) {
+                throw std::runtime_error("Error");
+            }
 
             current._mapped = info.pMappedData;
+            current._capacity = capacity;
+            ++_packetVersion;
+
+            //a fresh buffer needs everything
+            dirty.addAll();
+        }
+
+        //only the touched bytes of the live range
+        if (current._mapped && _data)
+            dirty.copy(current._mapped, _data, size);
+        else
+            dirty.clear();
+
+    }
+
+    void VertexBuffer::updateStatic(const Device& device, const SwapChain& swapChain)
+    {
+        auto& current = _buffers[0];
+
+        //earlier frames may still be drawing from the old buffer
+        if (current._buffer)
+        {
+            device.deletionQueue().destroyBuffer(current._buffer, current._memory);
+            current._buffer = VK_NULL_HANDLE;
+            current._memory = nullptr;
+            ++_packetVersion;
         }
 
-        //populate buffer
-        if (current._mapped && _data && _count)
-            memcpy(current._mapped, _data, _elementSize * _count);
+        if (_count == 0 || !_data)
+            return;
 
+        VkBuffer stagingBuffer{ VK_NULL_HANDLE };
+        VmaAllocation stagingMemory{ nullptr };
+        createDeviceLocalBuffer(device, swapChain, swapChain.frame(), _data, _elementSize * _count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, current._buffer, current._memory, stagingBuffer, stagingMemory);
+        device.deletionQueue().destroyBuffer(stagingBuffer, stagingMemory);
+        ++_packetVersion;
+    }
+
+    bool VertexBuffer::flushDirty(const Device& device, const SwapChain& swapChain)
+    {
+        update(device, swapChain);
+        return std::any_of(_dirties.begin(), _dirties.end(), [](const DirtyRanges& dirty) { return !dirty.empty(); });
     }
 
     void* VertexBuffer::data() const
@@ -89,24 +171,62 @@ namespace vkl
         return _count;
     }
 
+    BufferUsage VertexBuffer::usage() const
+    {
+        return _usage;
+    }
+
+    uint64_t VertexBuffer::packetVersion() const
+    {
+        return _packetVersion;
+    }
+
+    size_t VertexBuffer::capacity(size_t frameIndex) const
+    {
+        return _usage == BufferUsage::Static ? _elementSize * _count : _buffers[frameIndex]._capacity;
+    }
+
+    void VertexBuffer::setShrinkEnabled(bool enabled)
+    {
+        _shrinkEnabled = enabled;
+    }
+
+    bool VertexBuffer::shrinkEnabled() const
+    {
+        return _shrinkEnabled;
+    }
+
+    void VertexBuffer::setChangeDetection(bool enabled)
+    {
+        _changeDetection = enabled;
+        _contentHash.reset();
+    }
+
+    bool VertexBuffer::changeDetection() const
+    {
+        return _changeDetection;
+    }
+
     VkBuffer VertexBuffer::handle(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer;
+        return _buffers[_usage == BufferUsage::Static ? 0 : frameIndex]._buffer;
     }
 
     bool VertexBuffer::isValid(size_t frameIndex) const
     {
-        return _buffers[frameIndex]._buffer != VK_NULL_HANDLE;
+        return handle(frameIndex) != VK_NULL_HANDLE;
     }
 
     void VertexBuffer::cleanUp(const Device& device)
     {
+        //cleaned up while frames may still be drawing with it, BufferManager::cleanUnusedBuffers
         for (auto&& buffer : _buffers)
         {
-            vmaDestroyBuffer(device.allocatorHandle(), buffer._buffer, buffer._memory);
+            device.deletionQueue().destroyBuffer(buffer._buffer, buffer._memory);
             buffer._memory = nullptr;
             buffer._buffer = VK_NULL_HANDLE;
             buffer._mapped = nullptr;
+            buffer._capacity = 0;
         }
         _buffers.clear();
     }
@@ -1,5 +1,7 @@
 #include <vxt/Camera.h>
 
+#include <cstring>
+
 namespace vxt
 {
 	glm::mat4 Camera::view() const
@@ -18,6 +20,30 @@ namespace vxt
 	{
 		_proj = projection;
 	}
+	std::array<glm::vec4, 6> Camera::frustumPlanes() const
+	{
+		//rows of the clip matrix, depth is zero to one so near is just the z row
+		glm::mat4 clip = glm::transpose(_proj * _view);
+		std::array<glm::vec4, 6> planes{
+			clip[3] + clip[0],
+			clip[3] - clip[0],
+			clip[3] + clip[1],
+			clip[3] - clip[1],
+			clip[2],
+			clip[3] - clip[2]
+		};
+		for (auto&& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+		return planes;
+	}
+	vkl::CullFrustum Camera::cullFrustum() const
+	{
+		vkl::CullFrustum frustum{};
+		auto planes = frustumPlanes();
+		for (size_t i = 0; i < planes.size(); ++i)
+			memcpy(frustum.planes[i], glm::value_ptr(planes[i]), sizeof(frustum.planes[i]));
+		return frustum;
+	}
 	glm::vec4 Camera::viewport() const
 	{
 		return _viewport;
@@ -0,0 +1,247 @@
+#include <vxt/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+	//symmetric 4x4 matrix, summed squared distance to a set of planes
+	struct Quadric
+	{
+		double a[10]{};
+
+		void addPlane(const glm::dvec4& p)
+		{
+			a[0] += p.x * p.x; a[1] += p.x * p.y; a[2] += p.x * p.z; a[3] += p.x * p.w;
+			a[4] += p.y * p.y; a[5] += p.y * p.z; a[6] += p.y * p.w;
+			a[7] += p.z * p.z; a[8] += p.z * p.w;
+			a[9] += p.w * p.w;
+		}
+		double error(const Quadric& other, const glm::vec3& v) const
+		{
+			double q[10];
+			for (int i = 0; i < 10; ++i)
+				q[i] = a[i] + other.a[i];
+			double x = v.x, y = v.y, z = v.z;
+			double e = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+				+ q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+				+ q[7] * z * z + 2.0 * q[8] * z
+				+ q[9];
+			return std::max(e, 0.0);
+		}
+		void add(const Quadric& other)
+		{
+			for (int i = 0; i < 10; ++i)
+				a[i] += other.a[i];
+		}
+	};
+
+	//from moves onto to, stale once either vertex's quadric changed
+	struct Collapse
+	{
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return std::hash<uint64_t>()(((uint64_t)bits[0] << 32 | bits[1]) ^ ((uint64_t)bits[2] * 0x9E3779B97F4A7C15ull));
+		}
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+	}
+}
+
+namespace vxt
+{
+	float simplifyMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, size_t targetIndexCount, std::vector<uint32_t>& result)
+	{
+		result.assign(indices.begin(), indices.end());
+
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0 || targetIndexCount >= triangleCount * 3)
+			return 0.f;
+		for (auto index : indices)
+		{
+			if (index >= positions.size())
+				return 0.f;
+		}
+
+		size_t vertexCount = positions.size();
+
+		//vertices at the same position are one for topology, a seam between them can't move without tearing
+		std::vector<uint32_t> weld(vertexCount);
+		std::vector<uint8_t> locked(vertexCount, 0);
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAt;
+		firstAt.reserve(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			auto [it, inserted] = firstAt.try_emplace(positions[v], v);
+			weld[v] = it->second;
+			if (!inserted)
+				locked[v] = locked[it->second] = 1;
+		}
+
+		//edges with one triangle are open borders, more than two is non manifold, neither collapses cleanly
+		std::unordered_map<uint64_t, uint32_t> edgeUse;
+		edgeUse.reserve(triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+				++edgeUse[edgeKey(weld[indices[t * 3 + e]], weld[indices[t * 3 + (e + 1) % 3]])];
+		}
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = indices[t * 3 + e];
+				uint32_t b = indices[t * 3 + (e + 1) % 3];
+				if (edgeUse[edgeKey(weld[a], weld[b])] != 2)
+					locked[a] = locked[b] = 1;
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t* tri = &result[t * 3];
+			glm::dvec3 p0 = positions[tri[0]];
+			glm::dvec3 normal = glm::cross(glm::dvec3(positions[tri[1]]) - p0, glm::dvec3(positions[tri[2]]) - p0);
+			double length = glm::length(normal);
+			for (int i = 0; i < 3; ++i)
+				vertexTriangles[tri[i]].push_back(t);
+			if (length <= 0.0)
+				continue;
+			normal /= length;
+			glm::dvec4 plane(normal, -glm::dot(normal, p0));
+			for (int i = 0; i < 3; ++i)
+				quadrics[tri[i]].addPlane(plane);
+		}
+
+		std::vector<uint32_t> versions(vertexCount, 0);
+		std::vector<uint8_t> removed(vertexCount, 0);
+		std::vector<uint8_t> deadTriangles(triangleCount, 0);
+		size_t liveTriangles = triangleCount;
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+		auto push = [&](uint32_t from, uint32_t to) {
+			if (locked[from])
+				return;
+			heap.push({ quadrics[from].error(quadrics[to], positions[to]), from, to, versions[from], versions[to] });
+		};
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = result[t * 3 + e];
+				uint32_t b = result[t * 3 + (e + 1) % 3];
+				push(a, b);
+				push(b, a);
+			}
+		}
+
+		//collapsing must not fold a remaining triangle over or squash it flat
+		auto flips = [&](uint32_t from, uint32_t to) {
+			for (auto t : vertexTriangles[from])
+			{
+				if (deadTriangles[t])
+					continue;
+				const uint32_t* tri = &result[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+					continue;
+				glm::vec3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (int i = 0; i < 3; ++i)
+				{
+					if (tri[i] == from)
+						p[i] = positions[to];
+				}
+				glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+				if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+					return true;
+			}
+			return false;
+		};
+
+		double maxCost = 0.0;
+		while (liveTriangles * 3 > targetIndexCount && !heap.empty())
+		{
+			Collapse collapse = heap.top();
+			heap.pop();
+
+			if (removed[collapse.from] || removed[collapse.to])
+				continue;
+			if (versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+				continue;
+			if (flips(collapse.from, collapse.to))
+				continue;
+
+			for (auto t : vertexTriangles[collapse.from])
+			{
+				if (deadTriangles[t])
+					continue;
+				uint32_t* tri = &result[t * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					deadTriangles[t] = 1;
+					--liveTriangles;
+					continue;
+				}
+				for (int i = 0; i < 3; ++i)
+				{
+					if (tri[i] == collapse.from)
+						tri[i] = collapse.to;
+				}
+				vertexTriangles[collapse.to].push_back(t);
+			}
+			vertexTriangles[collapse.from].clear();
+			removed[collapse.from] = 1;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			++versions[collapse.to];
+			maxCost = std::max(maxCost, collapse.cost);
+
+			for (auto t : vertexTriangles[collapse.to])
+			{
+				if (deadTriangles[t])
+					continue;
+				for (int i = 0; i < 3; ++i)
+				{
+					uint32_t other = result[t * 3 + i];
+					if (other == collapse.to)
+						continue;
+					push(other, collapse.to);
+					push(collapse.to, other);
+				}
+			}
+		}
+
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (deadTriangles[t])
+				continue;
+			for (int i = 0; i < 3; ++i)
+				result[write++] = result[t * 3 + i];
+		}
+		result.resize(write);
+
+		return (float)std::sqrt(maxCost);
+	}
+}
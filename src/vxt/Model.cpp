@@ -0,0 +1,63 @@
+#include <vxt/Model.h>
+
+namespace vxt
+{
+	Model::Bounds Model::Bounds::transformed(const glm::mat4& transform) const
+	{
+		if (empty())
+			return *this;
+
+		//each axis of the transform moves min and max independently, keep whichever lands lower/higher
+		Bounds result;
+		result.min = result.max = glm::vec3(transform[3]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			glm::vec3 a = glm::vec3(transform[axis]) * min[axis];
+			glm::vec3 b = glm::vec3(transform[axis]) * max[axis];
+			result.min += glm::min(a, b);
+			result.max += glm::max(a, b);
+		}
+		return result;
+	}
+
+	glm::vec4 Model::Bounds::sphere() const
+	{
+		if (empty())
+			return glm::vec4(0.f);
+		return glm::vec4((min + max) * 0.5f, glm::length(max - min) * 0.5f);
+	}
+
+	Model::Bounds Model::Primitive::animatedBounds(const JointArray& joints, size_t jointCount) const
+	{
+		if (jointBounds.empty() || jointCount == 0)
+			return bounds;
+
+		//a skinned vertex is a weighted blend of its joints' transforms, so it stays inside the union of them
+		Bounds result;
+		for (auto&& joint : jointBounds)
+		{
+			if (joint.joint < jointCount)
+				result.expand(joint.bounds.transformed(joints[joint.joint]));
+		}
+		return result.empty() ? bounds : result;
+	}
+
+	size_t Model::Primitive::selectLod(float pixelsPerUnit, float maxPixelError) const
+	{
+		size_t lod = 0;
+		for (size_t i = 0; i < lods.size(); ++i)
+		{
+			if (lods[i].error * pixelsPerUnit > maxPixelError)
+				break;
+			lod = i + 1;
+		}
+		return lod;
+	}
+
+	std::shared_ptr<const vkl::DrawCall> Model::Primitive::lodDraw(size_t lod) const
+	{
+		if (lod == 0 || lod > lods.size())
+			return draw;
+		return lods[lod - 1].draw;
+	}
+}
@@ -4,12 +4,21 @@
 #include <vxt/Camera.h>
 #include <vkl/BufferManager.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
 namespace
 {
 	constexpr const char* VertShader = R"Shader(
 
 #version 450
 
+//the depth pre-pass draws with the same shader, EQUAL needs bit identical depth
+invariant gl_Position;
+
 layout(binding = 0) uniform MVP {
 	mat4 model;
 	mat4 view;
@@ -95,6 +104,68 @@ void main() {
 	gl_Position = u_mvp.proj * u_mvp.view * u_mvp.model * u_mvp.shape * skinMat * vec4(position, 1.f);
 }
 
+)Shader";
+
+	//VertShader without morph targets, the model matrix of each copy comes in as an instance attribute
+	constexpr const char* InstancedVertShader = R"Shader(
+
+#version 450
+
+//the depth pre-pass draws with the same shader, EQUAL needs bit identical depth
+invariant gl_Position;
+
+layout(binding = 0) uniform MVP {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+	mat4 shape;
+} u_mvp;
+
+layout(binding = 1) uniform Joints {
+	mat4 jointTransforms[128];
+	vec4 morphWeights;
+	float jointCount;
+	float morphTargetCount;
+} u_joints;
+
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec3 a_norm;
+layout(location = 2) in vec2 a_uv0;
+layout(location = 3) in vec2 a_uv1;
+layout(location = 4) in vec4 a_joint0;
+layout(location = 5) in vec4 a_weight0;
+
+layout(location = 6) in mat4 a_instance;
+
+layout (location = 0) out vec3 o_normal;
+layout (location = 1) out vec2 o_uV0;
+layout (location = 2) out vec2 o_uV1;
+layout (location = 3) out vec3 o_viewPosition;
+
+void main() {
+
+	mat4 skinMat = mat4(1);
+
+	if(u_joints.jointCount > 0)
+	{
+	skinMat = 
+		a_weight0.x * u_joints.jointTransforms[int(a_joint0.x)] +
+		a_weight0.y * u_joints.jointTransforms[int(a_joint0.y)] +
+		a_weight0.z * u_joints.jointTransforms[int(a_joint0.z)] +
+		a_weight0.w * u_joints.jointTransforms[int(a_joint0.w)];
+	}
+
+	mat4 modelView = u_mvp.view * u_mvp.model * a_instance * u_mvp.shape * skinMat;
+
+	o_viewPosition = (modelView * vec4(a_pos, 1.f)).xyz;
+	o_normal = mat3(modelView) * a_norm;
+
+	o_uV0 = a_uv0;
+	o_uV1 = a_uv1;
+
+	gl_Position = u_mvp.proj * modelView * vec4(a_pos, 1.f);
+}
+
 )Shader";
 
 	//Frag shader logic (mostly) taken from OpenGL 4 Shading Language Cookbook Third Edition
@@ -199,11 +270,15 @@ vec3 microfacetModel( int lightIdx, vec3 position, vec3 n ) {
 }
 
 void main() {
+	vec4 base = baseColor();
+	if(u_material.alphaMode_mask > 0.5 && base.a < u_material.alphaCutoff)
+		discard;
+
 	vec3 sum = vec3(0);
 	for( int i = 0; i < MaxLights; i++ ) {
 		sum += microfacetModel(i, viewPosition, normal);
 	}
-	outColor = vec4(sum, 1);
+	outColor = vec4(sum, u_material.alphaMode_blend > 0.5 ? base.a : 1);
 }
 
 )Shader";
@@ -211,6 +286,7 @@ void main() {
 }
 
 REGISTER_PIPELINE(vxt::ModelShapeObject, vxt::ModelShapeObject::describePipeline)
+REGISTER_PIPELINE(vxt::InstancedModelShapeObject, vxt::InstancedModelShapeObject::describePipeline)
 
 namespace {
 	constexpr uint32_t _Binding_VBO = 0;
@@ -218,6 +294,8 @@ namespace {
 	constexpr uint32_t _Binding_Morph1 = 2;
 	constexpr uint32_t _Binding_Morph2 = 3;
 	constexpr uint32_t _Binding_Morph3 = 4;
+	//vertex buffers are bound contiguously from 0, the instanced pipeline has no morph bindings
+	constexpr uint32_t _Binding_Instance = 1;
 
 	constexpr uint32_t _Attribute_Pos = 0;
 	constexpr uint32_t _Attribute_Norm = 1;
@@ -235,11 +313,91 @@ namespace {
 	constexpr uint32_t _Attribute_Morph3_Pos  = 12;
 	constexpr uint32_t _Attribute_Morph3_Norm = 13;
 
+	//instanced pipeline has no morph targets, a mat4 takes four locations
+	constexpr uint32_t _Attribute_Instance0 = 6;
+
 	constexpr uint32_t _Binding_MVP = 0;
 	constexpr uint32_t _Binding_Joints = 1;
 	constexpr uint32_t _Binding_BaseColorTexture = 2;
 	constexpr uint32_t _Binding_Lights = 3;
 	constexpr uint32_t _Binding_Material = 4;
+
+	//skinning moves vertices away from the bind pose the bounds are taken from
+	constexpr float CullBoundsPadding = 1.5f;
+
+	void describeShapeVertex(vkl::PipelineDescription& description)
+	{
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_Pos, VK_FORMAT_R32G32B32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, pos));
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_Norm, VK_FORMAT_R32G32B32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, normal));
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_UV0, VK_FORMAT_R32G32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, uv0));
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_UV1, VK_FORMAT_R32G32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, uv1));
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_Joint0, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, joint0));
+		description.declareVertexAttribute(_Binding_VBO, _Attribute_Weight0, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(vxt::Model::Vertex), offsetof(vxt::Model::Vertex, weight0));
+	}
+
+	void describeShapeUniforms(vkl::PipelineDescription& description)
+	{
+		description.declareUniform(_Binding_MVP, sizeof(vxt::ModelShapeObject::MVP));
+		description.declareUniform(_Binding_Joints, sizeof(vxt::ModelShapeObject::Joints));
+		description.declareUniform(_Binding_Lights, sizeof(vxt::ModelShapeObject::Lights));
+		description.declareUniform(_Binding_Material, sizeof(vxt::ModelShapeObject::PBRMaterial));
+
+		description.declareTexture(_Binding_BaseColorTexture);
+	}
+
+	vkl::RenderQueue shapeQueue(const vxt::Model& model, const vxt::Model::Primitive& shape)
+	{
+		if (shape.material < 0 || shape.material >= model.getMaterials().size())
+			return vkl::RenderQueue::Opaque;
+
+		switch (model.getMaterials()[shape.material].alphaMode)
+		{
+		case vxt::Model::Material::AlphaMode::ALPHAMODE_MASK:
+			return vkl::RenderQueue::Mask;
+		case vxt::Model::Material::AlphaMode::ALPHAMODE_BLEND:
+			return vkl::RenderQueue::Blend;
+		default:
+			return vkl::RenderQueue::Opaque;
+		}
+	}
+
+	vxt::ModelShapeObject::PBRMaterial shapeMaterial(const vxt::Model& model, const vxt::Model::Primitive& shape)
+	{
+		vxt::ModelShapeObject::PBRMaterial material;
+		if (shape.material >= 0 && shape.material < model.getMaterials().size())
+		{
+			const auto& mat = model.getMaterials()[shape.material];
+			material.alphaCutoff = mat.alphaCutoff;
+			material.alphaMode_blend = mat.alphaMode == vxt::Model::Material::AlphaMode::ALPHAMODE_BLEND;
+			material.alphaMode_mask = mat.alphaMode == vxt::Model::Material::AlphaMode::ALPHAMODE_MASK;
+			material.alphaMode_opaque = mat.alphaMode == vxt::Model::Material::AlphaMode::ALPHAMODE_OPAQUE;
+			material.baseColorFactor = mat.baseColorFactor;
+			material.metallicFactor = mat.metallicFactor;
+			material.roughnessFactor = mat.roughnessFactor;
+		}
+		return material;
+	}
+
+	struct LodCounters
+	{
+		std::atomic<uint64_t> switches{ 0 };
+		std::array<std::atomic<uint64_t>, vxt::MaxNumLods> selections{};
+	};
+
+	LodCounters& lodCounters()
+	{
+		static LodCounters counters;
+		return counters;
+	}
+
+	//the animated joints and the tail of the block, not all MaxNumJoints matrices
+	void uploadAnimatedJoints(vkl::TypedUniform<vxt::ModelShapeObject::Joints>& uniform, const vxt::ModelShapeObject::Joints& joints)
+	{
+		using Joints = vxt::ModelShapeObject::Joints;
+		size_t jointCount = std::min((size_t)joints.jointCount, vxt::MaxNumJoints);
+		uniform.setData(joints, 0, sizeof(glm::mat4) * jointCount);
+		uniform.setData(joints, offsetof(Joints, morphWeights), sizeof(Joints) - offsetof(Joints, morphWeights));
+	}
 }
 
 namespace vxt
@@ -250,14 +408,9 @@ namespace vxt
 
 		description.addShaderGLSL(VK_SHADER_STAGE_VERTEX_BIT, VertShader);
 		description.addShaderGLSL(VK_SHADER_STAGE_FRAGMENT_BIT, FragShader);
+		description.setAlphaVariants(true);
 
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_Pos, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, pos));
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_Norm, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, normal));
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_UV0, VK_FORMAT_R32G32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, uv0));
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_UV1, VK_FORMAT_R32G32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, uv1));
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_Joint0, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, joint0));
-		description.declareVertexAttribute(_Binding_VBO, _Attribute_Weight0, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(Model::Vertex), offsetof(Model::Vertex, weight0));
-		
+		describeShapeVertex(description);
 
 		description.declareVertexAttribute(_Binding_Morph0, _Attribute_Morph0_Pos, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::MorphVertex), offsetof(Model::MorphVertex, pos));
 		description.declareVertexAttribute(_Binding_Morph0, _Attribute_Morph0_Norm, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::MorphVertex), offsetof(Model::MorphVertex, normal));
@@ -268,22 +421,18 @@ namespace vxt
 		description.declareVertexAttribute(_Binding_Morph3, _Attribute_Morph3_Pos, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::MorphVertex), offsetof(Model::MorphVertex, pos));
 		description.declareVertexAttribute(_Binding_Morph3, _Attribute_Morph3_Norm, VK_FORMAT_R32G32B32_SFLOAT, sizeof(Model::MorphVertex), offsetof(Model::MorphVertex, normal));
 
-		
-		description.declareUniform(_Binding_MVP, sizeof(MVP));
-		description.declareUniform(_Binding_Joints, sizeof(Joints));
-		description.declareUniform(_Binding_Lights, sizeof(Lights));
-		description.declareUniform(_Binding_Material, sizeof(PBRMaterial));
 
-
-		description.declareTexture(_Binding_BaseColorTexture);
+		describeShapeUniforms(description);
 	}
 
 
 	ModelShapeObject::ModelShapeObject(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager)
 	{
-		_uniform = bufferManager.createTypedUniform<MVP>(device, swapChain);
-		_jointsUniform = bufferManager.createTypedUniform<Joints>(device, swapChain);
-		_lightsUniform = bufferManager.createTypedUniform<Lights>(device, swapChain);
+		_uniforms.transformUniform = bufferManager.createTypedUniform<MVP>(device, swapChain);
+		_uniforms.jointsUniform = bufferManager.createTypedUniform<Joints>(device, swapChain);
+		_uniforms.lightsUniform = bufferManager.createTypedUniform<Lights>(device, swapChain);
+		//rewritten from the camera every update, usually with the same lights
+		_uniforms.lightsUniform->setChangeDetection(true);
 		_materialUniform = bufferManager.createTypedUniform<PBRMaterial>(device, swapChain);
 	}
 
@@ -302,30 +451,22 @@ namespace vxt
 
 		addVBO(model->getVertexBuffer(), _Binding_VBO);
 		addDrawCall(shape.draw);
-
-		_transform.shape = shape.transform;
-		_joints.morphWeights = shape.morphWeights;
-		_joints.morphTargetCount = MaxNumMorphTargets;
-
-		_uniform->setData({});
-		addUniform(_uniform, _Binding_MVP);
-		_jointsUniform->setData(_joints);
-		addUniform(_jointsUniform, _Binding_Joints);
-		_lightsUniform->setData(_lights);
-		addUniform(_lightsUniform, _Binding_Lights);
+		_lod = 0;
+
+		_uniforms.transform.shape = shape.transform;
+		_uniforms.joints.morphWeights = shape.morphWeights;
+		_uniforms.joints.morphTargetCount = MaxNumMorphTargets;
+
+		_uniforms.transformUniform->setData({});
+		addUniform(_uniforms.transformUniform, _Binding_MVP);
+		_uniforms.jointsUniform->setData(_uniforms.joints);
+		addUniform(_uniforms.jointsUniform, _Binding_Joints);
+		_uniforms.lightsUniform->setData(_uniforms.lights);
+		addUniform(_uniforms.lightsUniform, _Binding_Lights);
 		if (shape.material >= 0 && shape.material < model->getMaterials().size())
-		{
 			addTexture(model->getMaterials()[shape.material].baseColorTexture, _Binding_BaseColorTexture);
-
-			const auto& mat = model->getMaterials()[shape.material];
-			_material.alphaCutoff = mat.alphaCutoff;
-			_material.alphaMode_blend = mat.alphaMode == Model::Material::AlphaMode::ALPHAMODE_BLEND;
-			_material.alphaMode_mask = mat.alphaMode == Model::Material::AlphaMode::ALPHAMODE_MASK;
-			_material.alphaMode_opaque = mat.alphaMode == Model::Material::AlphaMode::ALPHAMODE_OPAQUE;
-			_material.baseColorFactor = mat.baseColorFactor;
-			_material.metallicFactor = mat.metallicFactor;
-			_material.roughnessFactor = mat.roughnessFactor;
-		}
+		_material = shapeMaterial(*model, shape);
+		setRenderQueue(shapeQueue(*model, shape));
 		_materialUniform->setData(_material);
 		addUniform(_materialUniform, _Binding_Material);
 
@@ -341,29 +482,99 @@ namespace vxt
 		return _shapeIndex;
 	}
 
+	void ModelShapeObject::setLodPixelError(float pixels)
+	{
+		_lodPixelError = pixels;
+	}
+
+	float ModelShapeObject::lodPixelError() const
+	{
+		return _lodPixelError;
+	}
+
+	size_t ModelShapeObject::lod() const
+	{
+		return _lod;
+	}
+
+	uint64_t ModelShapeObject::lodSwitchCount()
+	{
+		return lodCounters().switches.load(std::memory_order_relaxed);
+	}
+
+	uint64_t ModelShapeObject::lodSelectionCount(size_t lod)
+	{
+		if (lod >= MaxNumLods)
+			return 0;
+		return lodCounters().selections[lod].load(std::memory_order_relaxed);
+	}
+
 	void ModelShapeObject::update(const vkl::Device& device, const vkl::SwapChain& swapChain, const glm::mat4& modelMatrix, const Camera& cam, std::shared_ptr<const Model> model, 
 		std::string_view animationName, double animationInput)
 	{
-		_transform.model = modelMatrix;
-		_transform.view = cam.view();
-		_transform.proj = cam.projection();
+		float sortDepth = updateUniforms(_uniforms, modelMatrix, cam, *model, _shapeIndex, animationName, animationInput);
+
+		//animated world space bounds so the dispatcher can skip the shape when it is off screen
+		const auto& shape = model->getPrimitives()[_shapeIndex];
+		glm::vec4 sphere = shape.animatedBounds(_uniforms.joints.joints, (size_t)_uniforms.joints.jointCount).transformed(_uniforms.transform.model * _uniforms.transform.shape).sphere();
+		if (sphere.w > 0.f)
+			setBoundingSphere(sphere.x, sphere.y, sphere.z, sphere.w);
+		else
+			clearBoundingSphere();
+
+		//level of detail from how many pixels one mesh space unit covers at the nearest point of the sphere
+		size_t lod = 0;
+		if (_lodPixelError > 0.f && !shape.lods.empty() && sphere.w > 0.f)
+		{
+			glm::mat4 world = _uniforms.transform.model * _uniforms.transform.shape;
+			float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+			float pixelsPerUnit = scale * 0.5f * (float)swapChain.swapChainExtent().height * std::abs(_uniforms.transform.proj[1][1]);
+			//perspective, orthographic needs no distance
+			if (_uniforms.transform.proj[3][3] == 0.f)
+			{
+				glm::vec3 eye = glm::vec3(glm::inverse(_uniforms.transform.view)[3]);
+				float distance = glm::length(glm::vec3(sphere) - eye) - sphere.w;
+				pixelsPerUnit = distance > 0.f ? pixelsPerUnit / distance : std::numeric_limits<float>::max();
+			}
+			lod = shape.selectLod(pixelsPerUnit, _lodPixelError);
+		}
+		if (lod != _lod)
+		{
+			setDrawCall(0, shape.lodDraw(lod));
+			_lod = lod;
+			lodCounters().switches.fetch_add(1, std::memory_order_relaxed);
+		}
+		lodCounters().selections[lod].fetch_add(1, std::memory_order_relaxed);
+
+		setSortDepth(sortDepth);
+	}
+
+	float ModelShapeObject::updateUniforms(ShapeUniforms& uniforms, const glm::mat4& modelMatrix, const Camera& cam, const Model& model, size_t shapeIndex,
+		std::string_view animationName, double animationInput)
+	{
+		uniforms.transform.model = modelMatrix;
+		uniforms.transform.view = cam.view();
+		uniforms.transform.proj = cam.projection();
 
-		if (model->supportsAnimations())
+		if (model.supportsAnimations())
 		{
-			if (model->animate(_joints.joints, _joints.jointCount, _transform.shape, _joints.morphWeights, _shapeIndex, animationName, animationInput))
+			if (model.animate(uniforms.joints.joints, uniforms.joints.jointCount, uniforms.transform.shape, uniforms.joints.morphWeights, shapeIndex, animationName, animationInput))
 			{
-				_jointsUniform->setData(_joints);
+				uploadAnimatedJoints(*uniforms.jointsUniform, uniforms.joints);
 			}
 		}
 
-		_uniform->setData(_transform);
+		uniforms.transformUniform->setData(uniforms.transform);
 
 		for (int i = 0; i < cam.lights().size(); ++i)
 		{
-			_lights.lights[i] = cam.lights()[i];
+			uniforms.lights.lights[i] = cam.lights()[i];
 		}
-		_lightsUniform->setData(_lights);
+		uniforms.lightsUniform->setData(uniforms.lights);
 
+		//distance of the shape origin from the eye, for front to back sorting
+		glm::vec4 viewPos = uniforms.transform.view * uniforms.transform.model * uniforms.transform.shape * glm::vec4(0.f, 0.f, 0.f, 1.f);
+		return -viewPos.z;
 	}
 
 	void ModelRenderObject::setModel(const vkl::Device& device, const vkl::SwapChain& swapChain, vkl::BufferManager& bufferManager, const vkl::PipelineManager& pipelines, std::shared_ptr<const Model> model)
@@ -414,4 +625,257 @@ namespace vxt
 		return _shapes;
 	}
 
-}
+
+	void InstancedModelShapeObject::describePipeline(vkl::PipelineDescription& description)
+	{
+		description.setPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+		description.addShaderGLSL(VK_SHADER_STAGE_VERTEX_BIT, InstancedVertShader);
+		description.addShaderGLSL(VK_SHADER_STAGE_FRAGMENT_BIT, FragShader);
+		description.setAlphaVariants(true);
+
+		describeShapeVertex(description);
+
+		for (uint32_t column = 0; column < 4; ++column)
+			description.declareVertexAttribute(_Binding_Instance, _Attribute_Instance0 + column, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(glm::mat4), sizeof(glm::vec4) * column, VK_VERTEX_INPUT_RATE_INSTANCE);
+
+		describeShapeUniforms(description);
+	}
+
+	InstancedModelShapeObject::InstancedModelShapeObject(const vkl::Device& device, const vkl::SwapChain& swapChain, const vkl::PipelineManager& pipelines, vkl::BufferManager& bufferManager)
+	{
+		_instanceBuffer = bufferManager.createVertexBuffer(device, swapChain);
+		_draw = std::make_shared<vkl::DrawCall>();
+		_uniforms.transformUniform = bufferManager.createTypedUniform<ModelShapeObject::MVP>(device, swapChain);
+		_uniforms.jointsUniform = bufferManager.createTypedUniform<ModelShapeObject::Joints>(device, swapChain);
+		_uniforms.lightsUniform = bufferManager.createTypedUniform<ModelShapeObject::Lights>(device, swapChain);
+		//rewritten from the camera every update, usually with the same lights
+		_uniforms.lightsUniform->setChangeDetection(true);
+		_materialUniform = bufferManager.createTypedUniform<ModelShapeObject::PBRMaterial>(device, swapChain);
+	}
+
+	void InstancedModelShapeObject::setShape(const vkl::Device& device, const vkl::SwapChain& swapChain, std::shared_ptr<const Model> model, size_t index)
+	{
+		if (!model)
+			return;
+		if (index >= model->getPrimitives().size())
+			return;
+
+		_shapeIndex = index;
+
+		reset();
+
+		const auto& shape = model->getPrimitives()[index];
+
+		//own copy of the primitive's draw so the instance count can be set without touching other objects sharing the model
+		_draw->setIndexBuffer(shape.draw->indexBuffer());
+		_draw->setCount(shape.draw->count());
+		_draw->setOffset(shape.draw->offset());
+		_draw->setVertexOffset(shape.draw->vertexOffset());
+		_draw->setInstanceCount(_instances.size());
+
+		addVBO(model->getVertexBuffer(), _Binding_VBO);
+		if (_culler)
+		{
+			addCulledInstances(_culler, _Binding_Instance);
+			_draw->setIndirect(_culler, _cullDraw, 1);
+		}
+		else
+		{
+			addVBO(_instanceBuffer, _Binding_Instance);
+			_draw->setIndirect(nullptr, 0, 0);
+		}
+		addDrawCall(_draw);
+
+		_uniforms.transform.shape = shape.transform;
+		_uniforms.joints.morphWeights = shape.morphWeights;
+
+		_uniforms.transformUniform->setData({});
+		addUniform(_uniforms.transformUniform, _Binding_MVP);
+		_uniforms.jointsUniform->setData(_uniforms.joints);
+		addUniform(_uniforms.jointsUniform, _Binding_Joints);
+		_uniforms.lightsUniform->setData(_uniforms.lights);
+		addUniform(_uniforms.lightsUniform, _Binding_Lights);
+		if (shape.material >= 0 && shape.material < model->getMaterials().size())
+			addTexture(model->getMaterials()[shape.material].baseColorTexture, _Binding_BaseColorTexture);
+		_material = shapeMaterial(*model, shape);
+		setRenderQueue(shapeQueue(*model, shape));
+		_materialUniform->setData(_material);
+		addUniform(_materialUniform, _Binding_Material);
+	}
+
+	size_t InstancedModelShapeObject::getShape() const
+	{
+		return _shapeIndex;
+	}
+
+	void InstancedModelShapeObject::setInstances(std::span<const glm::mat4> transforms)
+	{
+		_instances.assign(transforms.begin(), transforms.end());
+		_instanceBuffer->setData(_instances.data(), sizeof(glm::mat4), _instances.size());
+		if (_draw->instanceCount() != _instances.size())
+			_draw->setInstanceCount(_instances.size());
+	}
+
+	size_t InstancedModelShapeObject::instanceCount() const
+	{
+		return _instances.size();
+	}
+
+	void InstancedModelShapeObject::setCulling(std::shared_ptr<const vkl::GpuCuller> culler, uint32_t draw)
+	{
+		_culler = culler;
+		_cullDraw = draw;
+	}
+
+	void InstancedModelShapeObject::update(const vkl::Device& device, const vkl::SwapChain& swapChain, const glm::mat4& modelMatrix, const Camera& cam, std::shared_ptr<const Model> model,
+		std::string_view animationName, double animationInput)
+	{
+		setSortDepth(ModelShapeObject::updateUniforms(_uniforms, modelMatrix, cam, *model, _shapeIndex, animationName, animationInput));
+	}
+
+	void InstancedModelRenderObject::setModel(const vkl::Device& device, const vkl::SwapChain& swapChain, vkl::BufferManager& bufferManager, const vkl::PipelineManager& pipelines, std::shared_ptr<const Model> model)
+	{
+		_shapes.clear();
+
+		_model = model;
+
+		if (!model)
+			return;
+
+		for (int i = 0; i < model->getPrimitives().size(); ++i)
+		{
+			auto shape = std::make_shared<InstancedModelShapeObject>(device, swapChain, pipelines, bufferManager);
+			shape->setInstances(_instances);
+			shape->setShape(device, swapChain, model, i);
+			_shapes.push_back(shape);
+		}
+
+		if (_gpuCulling)
+			enableGpuCulling(device, swapChain);
+	}
+
+	std::shared_ptr<const Model> InstancedModelRenderObject::getModel() const
+	{
+		return _model;
+	}
+
+	void InstancedModelRenderObject::setInstances(std::span<const glm::mat4> transforms)
+	{
+		_instances.assign(transforms.begin(), transforms.end());
+		for (auto&& shape : _shapes)
+			shape->setInstances(_instances);
+		updateCullInstances();
+	}
+
+	std::span<const glm::mat4> InstancedModelRenderObject::instances() const
+	{
+		return _instances;
+	}
+
+	void InstancedModelRenderObject::animate(std::string_view animationName, double input)
+	{
+		_animationName = std::string(animationName);
+		_animationInput = input;
+	}
+
+	void InstancedModelRenderObject::update(const vkl::Device& device, const vkl::SwapChain& swapChain, const Camera& cam)
+	{
+		for (auto&& shape : _shapes)
+			shape->update(device, swapChain, _transform, cam, _model, _animationName, _animationInput);
+
+		for (auto&& culler : _cullers)
+			culler->setFrustum(cam.cullFrustum());
+	}
+
+	glm::mat4 InstancedModelRenderObject::getTransform() const
+	{
+		return _transform;
+	}
+
+	void InstancedModelRenderObject::setTransform(const glm::mat4& transform)
+	{
+		_transform = transform;
+		updateCullInstances();
+	}
+
+	std::span<const std::shared_ptr<InstancedModelShapeObject>> InstancedModelRenderObject::shapes() const
+	{
+		return _shapes;
+	}
+
+	std::span<const std::shared_ptr<vkl::GpuCuller>> InstancedModelRenderObject::enableGpuCulling(const vkl::Device& device, const vkl::SwapChain& swapChain)
+	{
+		_gpuCulling = true;
+
+		if (!_model)
+			return _cullers;
+
+		auto primitives = _model->getPrimitives();
+		while (_cullers.size() < primitives.size())
+			_cullers.push_back(std::make_shared<vkl::GpuCuller>(device, swapChain));
+
+		//only indexed primitives can go through a culler, the others and any left over from a bigger model get nothing to draw
+		_bounds.assign(primitives.size(), glm::vec4(0.f));
+		for (size_t i = 0; i < _cullers.size(); ++i)
+		{
+			//instances may point past the new draws until they are rebuilt
+			_cullers[i]->setInstances({});
+
+			std::shared_ptr<const vkl::DrawCall> draw = i < primitives.size() ? primitives[i].draw : nullptr;
+			if (!draw || !draw->indexBuffer() || draw->count() == 0)
+			{
+				_cullers[i]->setDraws({});
+				continue;
+			}
+			vkl::CullDraw cullDraw{ (uint32_t)draw->count(), (uint32_t)draw->offset(), draw->vertexOffset() };
+			_cullers[i]->setDraws(std::span<const vkl::CullDraw>(&cullDraw, 1));
+
+			glm::vec4 sphere = primitives[i].bounds.transformed(primitives[i].transform).sphere();
+			_bounds[i] = glm::vec4(glm::vec3(sphere), sphere.w * CullBoundsPadding);
+		}
+		updateCullInstances();
+
+		for (size_t i = 0; i < _shapes.size(); ++i)
+		{
+			_shapes[i]->setCulling(_bounds[i].w > 0.f ? _cullers[i] : nullptr, 0);
+			_shapes[i]->setShape(device, swapChain, _model, i);
+		}
+		return _cullers;
+	}
+
+	void InstancedModelRenderObject::updateCullInstances()
+	{
+		for (size_t draw = 0; draw < _bounds.size() && draw < _cullers.size(); ++draw)
+		{
+			_cullInstances.clear();
+			if (_bounds[draw].w > 0.f)
+			{
+				for (auto&& instance : _instances)
+				{
+					glm::mat4 world = _transform * instance;
+					glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(_bounds[draw]), 1.f));
+					float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+
+					vkl::CullInstance cull{};
+					memcpy(cull.transform, glm::value_ptr(instance), sizeof(cull.transform));
+					cull.center[0] = center.x;
+					cull.center[1] = center.y;
+					cull.center[2] = center.z;
+					cull.radius = _bounds[draw].w * scale;
+					cull.draw = 0;
+					_cullInstances.push_back(cull);
+				}
+			}
+			_cullers[draw]->setInstances(_cullInstances);
+		}
+	}
+
+	void InstancedModelRenderObject::cleanUp(const vkl::Device& device)
+	{
+		for (auto&& culler : _cullers)
+			culler->cleanUp(device);
+		_cullers.clear();
+		_gpuCulling = false;
+	}
+}
\ No newline at end of file
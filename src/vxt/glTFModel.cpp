@@ -7,6 +7,7 @@ https://github.com/SaschaWillems/Vulkan-glTF-PBR
 
 
 #include <vxt/Model.h>
+#include <vxt/MeshSimplifier.h>
 
 #include <vkl/Common.h>
 
@@ -201,7 +202,8 @@ namespace vxt
 			loadTextureSamplers(gltfModel);
 			loadTextures(gltfModel, device, swapChain, bufferManager);
 			loadMaterials(gltfModel);
-			_indexBuffer = bufferManager.createIndexBuffer(device, swapChain);
+			_indexBuffer = bufferManager.createIndexBuffer(device, swapChain, vkl::BufferUsage::Static);
+			_indexBuffer16 = bufferManager.createIndexBuffer(device, swapChain, vkl::BufferUsage::Static);
 
 			if (gltfModel.animations.size() > 0) {
 				loadAnimations(gltfModel);
@@ -212,14 +214,15 @@ namespace vxt
 				for (auto& node : scene.nodes)
 					loadNode(-1, gltfModel.nodes[node], node, gltfModel);
 
-			_vertexBuffer = bufferManager.createVertexBuffer(device, swapChain);
+			_vertexBuffer = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
 			_vertexBuffer->setData(_verts.data(), sizeof(Vertex), _verts.size());
 
 			_indexBuffer->setData(_indices);
+			_indexBuffer16->setData(_indices16);
 		
 			for (int i = 0; i < MaxNumMorphTargets; ++i)
 			{
-				_morphTargetBuffers[i] = bufferManager.createVertexBuffer(device, swapChain);
+				_morphTargetBuffers[i] = bufferManager.createVertexBuffer(device, swapChain, vkl::BufferUsage::Static);
 				_morphTargetBuffers[i]->setData(_morphTargets[i].data(), sizeof(MorphVertex), _morphTargets[i].size());
 			}
 
@@ -565,7 +568,6 @@ namespace vxt
 				const tinygltf::Mesh mesh = model.meshes[node.mesh];
 				for (size_t j = 0; j < mesh.primitives.size(); j++) {
 					const tinygltf::Primitive& primitive = mesh.primitives[j];
-					uint32_t indexStart = static_cast<uint32_t>(_indices.size());
 					uint32_t vertexStart = static_cast<uint32_t>(_verts.size());
 					uint32_t indexCount = 0;
 					uint32_t vertexCount = 0;
@@ -731,8 +733,52 @@ namespace vxt
 					for (auto&& mt : _morphTargets)
 						mt.resize(_verts.size(), {});
 
+					// Bounds, grown by the furthest each morph target can push a vertex
+					glm::vec3 morphMin(0.0f);
+					glm::vec3 morphMax(0.0f);
+					for (auto&& mt : _morphTargets)
+					{
+						glm::vec3 targetMin(0.0f);
+						glm::vec3 targetMax(0.0f);
+						for (size_t v = vertexStart; v < mt.size(); v++) {
+							targetMin = glm::min(targetMin, mt[v].pos);
+							targetMax = glm::max(targetMax, mt[v].pos);
+						}
+						morphMin += targetMin;
+						morphMax += targetMax;
+					}
+					prim.bounds.expand(posMin + morphMin);
+					prim.bounds.expand(posMax + morphMax);
 
-					// Indices
+					if (hasSkin)
+					{
+						std::vector<Model::Bounds> jointBounds(MaxNumJoints);
+						for (size_t v = vertexStart; v < _verts.size(); v++) {
+							for (int k = 0; k < 4; k++) {
+								uint32_t joint = static_cast<uint32_t>(_verts[v].joint0[k]);
+								if (_verts[v].weight0[k] > 0.0f && joint < MaxNumJoints)
+									jointBounds[joint].expand(_verts[v].pos);
+							}
+						}
+						for (uint32_t joint = 0; joint < MaxNumJoints; joint++) {
+							if (jointBounds[joint].empty())
+								continue;
+							jointBounds[joint].min += morphMin;
+							jointBounds[joint].max += morphMax;
+							prim.jointBounds.push_back({ joint, jointBounds[joint] });
+						}
+					}
+
+
+					// Indices, relative to the primitive's first vertex so they stay 16 bit whenever its vertices fit
+					bool shortIndices = vertexCount <= std::numeric_limits<uint16_t>::max() + 1u;
+					uint32_t indexStart = static_cast<uint32_t>(shortIndices ? _indices16.size() : _indices.size());
+					auto appendIndex = [&](uint32_t index) {
+						if (shortIndices)
+							_indices16.push_back(static_cast<uint16_t>(index));
+						else
+							_indices.push_back(index);
+					};
 					if (hasIndices)
 					{
 						const tinygltf::Accessor& accessor = model.accessors[primitive.indices > -1 ? primitive.indices : 0];
@@ -746,21 +792,21 @@ namespace vxt
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
 							const uint32_t* buf = static_cast<const uint32_t*>(dataPtr);
 							for (size_t index = 0; index < accessor.count; index++) {
-								_indices.push_back(buf[index] + vertexStart);
+								appendIndex(buf[index]);
 							}
 							break;
 						}
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
 							const uint16_t* buf = static_cast<const uint16_t*>(dataPtr);
 							for (size_t index = 0; index < accessor.count; index++) {
-								_indices.push_back(buf[index] + vertexStart);
+								appendIndex(buf[index]);
 							}
 							break;
 						}
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
 							const uint8_t* buf = static_cast<const uint8_t*>(dataPtr);
 							for (size_t index = 0; index < accessor.count; index++) {
-								_indices.push_back(buf[index] + vertexStart);
+								appendIndex(buf[index]);
 							}
 							break;
 						}
@@ -773,8 +819,44 @@ namespace vxt
 					auto drawCall = std::make_shared<vkl::DrawCall>();
 					drawCall->setCount(indexCount);
 					drawCall->setOffset(indexStart);
-					drawCall->setIndexBuffer(_indexBuffer);
+					drawCall->setVertexOffset(static_cast<int32_t>(vertexStart));
+					drawCall->setIndexBuffer(shortIndices ? _indexBuffer16 : _indexBuffer);
 					prim.draw = drawCall;
+
+					// Levels of detail, each simplified from the last and appended after it so they share the index buffer and vertex offset
+					constexpr uint32_t MinLodIndexCount = 3 * 256;
+					if (hasIndices && indexCount >= MinLodIndexCount)
+					{
+						std::vector<glm::vec3> positions(vertexCount);
+						for (uint32_t v = 0; v < vertexCount; v++)
+							positions[v] = _verts[vertexStart + v].pos;
+						std::vector<uint32_t> source(indexCount);
+						for (uint32_t index = 0; index < indexCount; index++)
+							source[index] = shortIndices ? _indices16[indexStart + index] : _indices[indexStart + index];
+
+						std::vector<uint32_t> simplified;
+						float error = 0.0f;
+						while (prim.lods.size() + 1 < MaxNumLods)
+						{
+							error += simplifyMesh(positions, source, source.size() / 2, simplified);
+							// Not worth a level once borders and seams are most of what's left
+							if (simplified.empty() || simplified.size() * 4 > source.size() * 3)
+								break;
+
+							uint32_t lodStart = static_cast<uint32_t>(shortIndices ? _indices16.size() : _indices.size());
+							for (auto index : simplified)
+								appendIndex(index);
+
+							auto lodDraw = std::make_shared<vkl::DrawCall>();
+							lodDraw->setCount(static_cast<uint32_t>(simplified.size()));
+							lodDraw->setOffset(lodStart);
+							lodDraw->setVertexOffset(static_cast<int32_t>(vertexStart));
+							lodDraw->setIndexBuffer(shortIndices ? _indexBuffer16 : _indexBuffer);
+							prim.lods.push_back({ lodDraw, error });
+							source.swap(simplified);
+						}
+					}
+
 					prim.material = primitive.material;
 					prim.transform = getMatrix(_nodeTransforms, nodeIndex);
 					_primitives.emplace_back(std::move(prim));
@@ -808,6 +890,16 @@ namespace vxt
 			return _indexBuffer;
 		}
 
+		virtual std::span<const uint16_t> getIndices16() const  override
+		{
+			return _indices16;
+		}
+
+		virtual std::shared_ptr<const vkl::IndexBuffer> getIndexBuffer16() const  override
+		{
+			return _indexBuffer16;
+		}
+
 		virtual std::span<const Primitive> getPrimitives() const  override
 		{
 			return _primitives;
@@ -1016,6 +1108,7 @@ namespace vxt
 		//external
 		std::shared_ptr<vkl::VertexBuffer> _vertexBuffer;
 		std::shared_ptr<vkl::IndexBuffer> _indexBuffer;
+		std::shared_ptr<vkl::IndexBuffer> _indexBuffer16;
 		std::vector<std::shared_ptr<vkl::TextureBuffer>> _textureBuffers;
 		std::vector<Model::Material> _materials;
 		std::vector<Model::Primitive> _primitives;
@@ -1023,6 +1116,7 @@ namespace vxt
 		//internal
 		std::vector<Model::Vertex> _verts;
 		std::vector<uint32_t> _indices;
+		std::vector<uint16_t> _indices16;
 
 		std::vector<vkl::TextureOptions> _texOptions;
 